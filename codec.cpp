@@ -0,0 +1,215 @@
+//
+// @file    : codec.cpp
+// @purpose : Wire encodings of rows of H sent between processes
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "codec.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scalar conversions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Convert a float to IEEE half precision, rounding to nearest even
+//
+static uint16_t float_to_half(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    int32_t  exp  = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff)                 // inf or nan
+        return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0));
+    if (exp >= 31)                                  // overflow
+        return (uint16_t)(sign | 0x7c00);
+    if (exp <= 0) {                                 // subnormal or zero
+        if (exp < -10)
+            return (uint16_t)sign;
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            h++;
+        return (uint16_t)(sign | h);
+    }
+
+    uint32_t h = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        h++;                                        // a carry correctly bumps the exponent
+    return (uint16_t)h;
+}
+
+//
+// @brief: Convert an IEEE half precision value to float
+//
+static float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp  = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+
+    if (exp == 0) {
+        float v = ldexp((float)mant, -24);
+        return sign ? -v : v;
+    }
+
+    uint32_t x;
+    if (exp == 31)
+        x = sign | 0x7f800000 | (mant << 13);
+    else
+        x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+//
+// @brief: Convert a float to bfloat16, rounding to nearest even
+//
+static uint16_t float_to_bf16(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7fffffff) > 0x7f800000)              // nan
+        return (uint16_t)((x >> 16) | 0x40);
+    x += 0x7fff + ((x >> 16) & 1);
+    return (uint16_t)(x >> 16);
+}
+
+//
+// @brief: Convert a bfloat16 value to float
+//
+static float bf16_to_float(uint16_t b) {
+    uint32_t x = (uint32_t)b << 16;
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Row encodings
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Parse a codec name: "none" (or "fp64"), "fp32", "fp16", "bf16", "int8"
+//
+bool parse_wire_codec(const string &name, WireCodec &codec) {
+    if (name == "none" || name == "fp64")   codec = WireCodec::FP64;
+    else if (name == "fp32")                codec = WireCodec::FP32;
+    else if (name == "fp16")                codec = WireCodec::FP16;
+    else if (name == "bf16")                codec = WireCodec::BF16;
+    else if (name == "int8")                codec = WireCodec::INT8;
+    else                                    return false;
+    return true;
+}
+
+//
+// @brief: The name of a codec, for reports
+//
+string wire_codec_name(WireCodec codec) {
+    switch (codec) {
+        case WireCodec::FP64:   return "fp64";
+        case WireCodec::FP32:   return "fp32";
+        case WireCodec::FP16:   return "fp16";
+        case WireCodec::BF16:   return "bf16";
+        case WireCodec::INT8:   return "int8";
+    }
+    return "unknown";
+}
+
+//
+// @brief: The number of bytes of one encoded row of K values
+//
+size_t encoded_row_bytes(WireCodec codec, int K) {
+    switch (codec) {
+        case WireCodec::FP64:   return K * sizeof(double);
+        case WireCodec::FP32:   return K * sizeof(float);
+        case WireCodec::FP16:
+        case WireCodec::BF16:   return K * sizeof(uint16_t);
+        case WireCodec::INT8:   return sizeof(float) + K * sizeof(int8_t);
+    }
+    return 0;
+}
+
+//
+// @brief: Encode a row of K doubles into encoded_row_bytes(codec, K) bytes
+//
+void encode_row(const double *row, int K, WireCodec codec, uint8_t *out) {
+    switch (codec) {
+        case WireCodec::FP64: {
+            memcpy(out, row, K * sizeof(double));
+            break;
+        }
+        case WireCodec::FP32: {
+            for (int k = 0; k < K; k++) {
+                float v = (float)row[k];
+                memcpy(out + k * sizeof(float), &v, sizeof(float));
+            }
+            break;
+        }
+        case WireCodec::FP16:
+        case WireCodec::BF16: {
+            for (int k = 0; k < K; k++) {
+                uint16_t v = (codec == WireCodec::FP16) ? float_to_half((float)row[k]) : float_to_bf16((float)row[k]);
+                memcpy(out + k * sizeof(uint16_t), &v, sizeof(uint16_t));
+            }
+            break;
+        }
+        case WireCodec::INT8: {
+            double max_abs = 0.0;
+            for (int k = 0; k < K; k++)
+                max_abs = max(max_abs, fabs(row[k]));
+            float scale = (float)(max_abs / 127.0);
+            memcpy(out, &scale, sizeof(float));
+            for (int k = 0; k < K; k++) {
+                double q = (scale > 0.0f) ? round(row[k] / scale) : 0.0;
+                out[sizeof(float) + k] = (uint8_t)(int8_t)max(-127.0, min(127.0, q));
+            }
+            break;
+        }
+    }
+}
+
+//
+// @brief: Decode a row of K doubles encoded by encode_row
+//
+void decode_row(const uint8_t *in, int K, WireCodec codec, double *row) {
+    switch (codec) {
+        case WireCodec::FP64: {
+            memcpy(row, in, K * sizeof(double));
+            break;
+        }
+        case WireCodec::FP32: {
+            for (int k = 0; k < K; k++) {
+                float v;
+                memcpy(&v, in + k * sizeof(float), sizeof(float));
+                row[k] = v;
+            }
+            break;
+        }
+        case WireCodec::FP16:
+        case WireCodec::BF16: {
+            for (int k = 0; k < K; k++) {
+                uint16_t v;
+                memcpy(&v, in + k * sizeof(uint16_t), sizeof(uint16_t));
+                row[k] = (codec == WireCodec::FP16) ? half_to_float(v) : bf16_to_float(v);
+            }
+            break;
+        }
+        case WireCodec::INT8: {
+            float scale;
+            memcpy(&scale, in, sizeof(float));
+            for (int k = 0; k < K; k++)
+                row[k] = (double)(int8_t)in[sizeof(float) + k] * scale;
+            break;
+        }
+    }
+}
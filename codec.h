@@ -0,0 +1,41 @@
+//
+// @file    : codec.h
+// @purpose : Wire encodings of rows of H sent between processes
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CODEC_H_
+#define CODEC_H_
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+//
+// @brief: Encoding of one row of K doubles on the wire:
+//  + FP64: raw doubles (8K bytes)
+//  + FP32: floats (4K bytes)
+//  + FP16: IEEE half precision (2K bytes)
+//  + BF16: bfloat16, the upper half of a float (2K bytes)
+//  + INT8: a float scale followed by K signed bytes, v = q * scale (K + 4 bytes)
+//
+enum class WireCodec { FP64, FP32, FP16, BF16, INT8 };
+
+bool                    parse_wire_codec(const string &name, WireCodec &codec);
+string                  wire_codec_name(WireCodec codec);
+size_t                  encoded_row_bytes(WireCodec codec, int K);
+void                    encode_row(const double *row, int K, WireCodec codec, uint8_t *out);
+void                    decode_row(const uint8_t *in, int K, WireCodec codec, double *row);
+
+#endif // CODEC_H_
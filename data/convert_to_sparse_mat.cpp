@@ -1,55 +1,167 @@
 #include <iostream>
 #include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <fstream>
+#include <thread>
+#include <algorithm>
+#include "../data_io.h"
+#include "../id_map.h"
 using namespace std;
 
-vector<vector<int>> data;
+// One line "user_id item_id rating [timestamp]" with the external ids
+struct RawRating {
+    uint64_t user_key;
+    uint64_t item_key;
+    double value;
+};
+
+// Parse the lines of text[begin, end) (cut at line starts); zero ratings
+// are not kept, so that their ids only enter the dictionary with a rating
+void parse_ratings(const string &text, size_t begin, size_t end, vector<RawRating> &ratings,
+                   IdMap &users_seen, IdMap &items_seen, long long &num_malformed){
+    const char *p = text.c_str() + begin;
+    const char *last = text.c_str() + end;
+    while (p < last) {
+        const char *eol = p;
+        while (eol < last && *eol != '\n')
+            eol++;
+
+        // strtoull/strtod skip newlines too: a field found past eol is missing
+        char *q1, *q2, *q3;
+        RawRating rating;
+        rating.user_key = strtoull(p, &q1, 10);
+        rating.item_key = strtoull(q1, &q2, 10);
+        rating.value = strtod(q2, &q3);
+        if (q1 > p && q2 > q1 && q3 > q2 && q3 <= eol) {
+            if (rating.value != 0) {
+                ratings.push_back(rating);
+                users_seen.insert(rating.user_key, 0);
+                items_seen.insert(rating.item_key, 0);
+            }
+        } else if (string(p, eol).find_first_not_of(" \t\r") != string::npos) {
+            num_malformed++;
+        }
+        p = eol + 1;
+    }
+}
+
+// The first line start at or after pos
+size_t next_line_start(const string &text, size_t pos){
+    if (pos == 0)
+        return 0;
+    while (pos < text.size() && text[pos - 1] != '\n')
+        pos++;
+    return min(pos, text.size());
+}
+
+// The sorted distinct keys of the per-thread sets
+vector<uint64_t> merge_keys(const vector<IdMap> &seen){
+    vector<uint64_t> keys;
+    for (auto &set : seen) {
+        vector<uint64_t> part = set.keys();
+        keys.insert(keys.end(), part.begin(), part.end());
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
 
 // Argument:
-//  + argv[1]   =   file_input (char*, e.g. "matrix.txt")
+//  + argv[1]   =   file_input (char*, e.g. "u1.base", one "user_id item_id rating [timestamp]" per line,
+//                  the ids being any 64-bit keys)
+//  + argv[2]   =   IDS_FILE (optional, "-" = build the dictionary from file_input, default "-"),
+//                  e.g. "ids_sparse_u1.base" to convert "u1.test" with the rows and columns of "u1.base"
+//  + argv[3]   =   NUM_THREADS (optional, default std::thread::hardware_concurrency())
+// Output:
+//  + sparse_[file_input]       the dense rating matrix of the users and items having ratings
+//  + ids_sparse_[file_input]   their external ids (row i is user_keys[i], column j is item_keys[j])
 int main(int argc, char **argv){
     // Collect program arguments
     if (argc < 2)
         exit(0);
     const string file_input(argv[1]);
-    int USERS = 943;
-    int ITEMS = 1682;
-
-    // Init mat space
-    data.resize(USERS);
-    for(int i=0; i<data.size();i++)
-        data[i] = vector<int>(ITEMS, 0);
+    const string file_ids = (argc > 2) ? string(argv[2]) : string("-");
+    int NUM_THREADS = (argc > 3) ? atoi(argv[3]) : max(1, (int)thread::hardware_concurrency());
+    NUM_THREADS = max(1, NUM_THREADS);
 
     // Read data
-    ifstream data_file_train(file_input, ios::in);
-    if (data_file_train.is_open()) {
-        int usr_id, item_id, rating, timestep;
-        while(data_file_train >> usr_id >> item_id >> rating >> timestep){
-            data[usr_id-1][item_id-1] = rating;
-        }
+    ifstream data_file(file_input, ios::in | ios::binary);
+    if (data_file.is_open() == false)
+        exit(0);
+    string text((istreambuf_iterator<char>(data_file)), istreambuf_iterator<char>());
+    data_file.close();
+
+    // Parse 1/NUM_THREADS of the lines per thread, collecting the ids seen
+    vector<vector<RawRating>> ratings(NUM_THREADS);
+    vector<IdMap> users_seen(NUM_THREADS), items_seen(NUM_THREADS);
+    vector<long long> num_malformed(NUM_THREADS, 0);
+    vector<thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            size_t begin = next_line_start(text, text.size() * t / NUM_THREADS);
+            size_t end = next_line_start(text, text.size() * (t + 1) / NUM_THREADS);
+            parse_ratings(text, begin, end, ratings[t], users_seen[t], items_seen[t], num_malformed[t]);
+        });
     }
-    data_file_train.close();
-
-    // Declare output file name
-    std::size_t found = file_input.find_last_of("/\\");
-    string _path_ = file_input.substr(0,found);
-    string _file_ = file_input.substr(found+1);
-    string file_output = _path_ + "/sparse_" + _file_;
-
-    // Write data
-    ofstream export_file(file_output, ios::out);
-    export_file << USERS << " " << ITEMS << endl;
-    if (export_file.is_open()) {
-        for (auto row : data) {
-            for (auto v : row) 
-                export_file << v << "  ";
-            export_file << endl;
-        }
+    for (auto &th : threads)
+        th.join();
+    threads.clear();
+    string().swap(text);
+
+    // Compact dense indices: the sorted keys having ratings, or the given dictionary
+    IdDictionary dictionary;
+    if (file_ids == "-") {
+        dictionary.user_keys = merge_keys(users_seen);
+        dictionary.item_keys = merge_keys(items_seen);
+        dictionary.build_index();
+    } else if (read_id_dictionary(file_ids, dictionary) == false) {
+        fprintf(stderr, "Cannot read dictionary %s\n", file_ids.c_str());
+        exit(1);
     }
-    export_file.close();
+    int USERS = dictionary.user_keys.size();
+    int ITEMS = dictionary.item_keys.size();
+    if (USERS == 0 || ITEMS == 0)
+        exit(0);
 
-    return 0;
-}
+    long long num_parsed = 0;
+    for (auto &part : ratings)
+        num_parsed += part.size();
 
+    // Translate the ratings in parallel, then fill the matrix in file order
+    // (the last of duplicated ratings wins); unknown ids are dropped
+    vector<vector<Rating>> indexed(NUM_THREADS);
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            for (auto &rating : ratings[t]) {
+                int user_idx = dictionary.user_index.find(rating.user_key);
+                int item_idx = dictionary.item_index.find(rating.item_key);
+                if (user_idx >= 0 && item_idx >= 0)
+                    indexed[t].push_back(Rating{user_idx, item_idx, rating.value});
+            }
+            vector<RawRating>().swap(ratings[t]);
+        });
+    }
+    for (auto &th : threads)
+        th.join();
+
+    vector<vector<double>> data(USERS, vector<double>(ITEMS, 0.0));
+    long long num_kept = 0;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        for (auto &rating : indexed[t])
+            data[rating.user_idx][rating.item_idx] = rating.value;
+        num_kept += indexed[t].size();
+    }
+    long long malformed = 0;
+    for (long long count : num_malformed)
+        malformed += count;
 
+    // Write data and its dictionary
+    string file_output = sibling_path(file_input, "sparse_");
+    write_data(file_output, data);
+    write_id_dictionary(sibling_path(file_output, "ids_"), dictionary);
+    printf(">\t%s: %d users x %d items, %lld ratings kept (%lld with unknown ids dropped, %lld malformed lines)\n",
+           file_output.c_str(), USERS, ITEMS, num_kept, num_parsed - num_kept, malformed);
+
+    return 0;
+}
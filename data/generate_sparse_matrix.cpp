@@ -5,6 +5,7 @@
 #include <vector>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
 #define bug(x) cout << #x << " = " << x << endl
 using namespace std;
 
@@ -18,15 +19,54 @@ int get_amount_zero(int max_num_zero){
     return ans;
 }
 
+// Sample a column with probability proportional to 1/(col+1)^s, using the
+// cumulative distribution 'cdf'
+int get_zipf_column(const vector<double> &cdf){
+    double u = (double)rand() / ((double)RAND_MAX + 1.0) * cdf.back();
+    return (int)(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+}
+
+// Fill matrix a with a heavy-tailed item popularity: every row rates
+// 1..NCOL/5 columns drawn from a Zipf distribution of exponent s, then
+// every empty column gets one rating in a random row
+void fill_zipf(vector<vector<int>> &a, int NROW, int NCOL, double s){
+    vector<double> cdf(NCOL);
+    for(int j=0;j<NCOL;j++)
+        cdf[j] = (j > 0 ? cdf[j-1] : 0.0) + 1.0 / pow(j + 1.0, s);
+
+    for(int i=0;i<NROW;i++){
+        a[i].assign(NCOL, 0);
+        int num_ratings = 1 + rand()%max(1, NCOL/5);
+        for(int t=0;t<num_ratings;t++){
+            int c = get_zipf_column(cdf);
+            a[i][c] = get_random_rating();
+        }
+    }
+
+    for(int j=0;j<NCOL;j++){
+        bool empty = true;
+        for(int i=0;i<NROW && empty;i++)
+            empty = (a[i][j] == 0);
+        if(empty)
+            a[rand()%NROW][j] = get_random_rating();
+    }
+}
+
+// Argument:
+//  + argv[1]   =   file_output (char*, e.g. "matrix.txt")
+//  + argv[2]   =   NROW (int)
+//  + argv[3]   =   NCOL (int)
+//  + argv[4]   =   ZIPF_S (optional, double > 0: Zipf-skewed item popularity)
 int main(int argc, char **argv){
     // Collect program arguments
-    if (argc < 3)
+    if (argc < 4)
         exit(0);
     string file_output(argv[1]);
     int NROW = atoi(argv[2]);
     int NCOL = atoi(argv[3]);;
 
     srand (time(NULL));   
+    double ZIPF_S = (argc > 4) ? atof(argv[4]) : 0.0;
 
     // int a[NROW][NCOL] = {0};
     vector<vector<int>>a(NROW);
@@ -42,7 +82,9 @@ int main(int argc, char **argv){
     }
 
     int max_num_zeros = NROW*NCOL - max(NROW,NCOL);
-    int num_zeros = get_amount_zero(max_num_zeros);
+    int num_zeros = (ZIPF_S > 0.0) ? 0 : get_amount_zero(max_num_zeros);
+    if (ZIPF_S > 0.0)
+        fill_zipf(a, NROW, NCOL, ZIPF_S);
 
     // bug(max_num_zeros);
     // bug(num_zeros);
@@ -0,0 +1,228 @@
+//
+// @file    : data_io.cpp
+// @purpose : Reading, writing and partitioning of the rating matrix
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 03/07/2020
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "data_io.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Subsidiary functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Read the input data into pass matrix
+//
+void read_data(const string file_input, int &NROW, int &NCOL,
+               vector<vector<double>> &arr_data, vector<int> &row_count) {
+    // Init file stream
+    ifstream data_file(file_input, ios::in);
+
+    // Read data
+    if (data_file.is_open()) {
+        data_file >> NROW >> NCOL;
+        arr_data.resize(NROW);
+        row_count = vector<int>(NROW, 0);
+
+        for (int i = 0; i < NROW; i++) {
+            for (int j = 0; j < NCOL; j++) {
+                double v;
+                data_file >> v;
+                arr_data[i].push_back(v);
+                if (v != 0)
+                    row_count[i]++;
+            }
+        }
+    }
+
+    data_file.close();
+}
+
+//
+// @brief: Write output matrix into export file
+//
+void write_data(const string file_output, vector<vector<double>> &arr_data) {
+    // Init file stream
+    ofstream export_file(file_output, ios::out);
+    export_file << arr_data.size() << " " << arr_data[0].size() << endl;
+    
+    // Read data
+    if (export_file.is_open()) {
+        for (auto row : arr_data) {
+            for (auto v : row) 
+                export_file << fixed << setprecision(2) << v << "  ";
+            export_file << endl;
+        }
+    }
+
+    export_file.close();
+}
+
+//
+// @brief: Read the input data into pass matrix
+//
+void assert_matrix_size(vector<vector<double>> &mat, int nRows, int nCols) {
+    assert(mat.size() == nRows);
+    for (auto row : mat)
+        assert(row.size() == nCols);
+}
+
+//
+// @brief: Split the input array into K least-size-different parts
+//
+vector<vector<int>> split_array_index(const vector<int> &arr, int num_segment) {
+    assert(num_segment <= (int)arr.size());
+
+    vector<pair<int, int>> input_arr;
+    for (int i = 0; i < arr.size(); i++) {
+        input_arr.push_back(make_pair(arr[i], i));
+    }
+
+    sort(input_arr.begin(), input_arr.end(), greater<pair<int, int>>());
+
+    vector<vector<int>> ans(num_segment);
+    vector<int> sum(num_segment, 0);
+
+    for (auto v : input_arr) {
+        int min_val = *min_element(sum.begin(), sum.end());
+        vector<int>::iterator it = find(sum.begin(), sum.end(), min_val);
+        int min_pos = it - sum.begin();
+
+        sum[min_pos] += v.first;
+        ans[min_pos].push_back(v.second);
+    }
+
+    return ans;
+}
+
+//
+// @brief: The path of the file named 'prefix' + name of 'file', in the same
+// directory as 'file' (e.g. "data/m.txt", "out_" -> "data/out_m.txt")
+//
+string sibling_path(const string file, const string prefix) {
+    std::size_t found = file.find_last_of("/\\");
+    if (found == string::npos)
+        return prefix + file;
+    return file.substr(0, found) + "/" + prefix + file.substr(found + 1);
+}
+
+//
+// @brief: Read a list of ratings in the MovieLens format, one
+// "user_id item_id rating [timestamp]" per line with ids from 1
+//
+bool read_rating_list(const string file_input, vector<Rating> &ratings) {
+    ifstream data_file(file_input, ios::in);
+    if (data_file.is_open() == false)
+        return false;
+
+    string line;
+    while (getline(data_file, line)) {
+        istringstream fields(line);
+        Rating rating;
+        if (!(fields >> rating.user_idx >> rating.item_idx >> rating.value))
+            continue;
+        if (rating.user_idx <= 0 || rating.item_idx <= 0)
+            return false;
+        rating.user_idx--;
+        rating.item_idx--;
+        ratings.push_back(rating);
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental training
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Write a factor model: "NROW NCOL K", then the NROW rows of W and
+// the NCOL rows of H, K values per line, at full double precision
+//
+void write_model(const string file_output, int NROW, int NCOL, int K,
+                 const vector<double> &W, const vector<double> &H) {
+    assert((int)W.size() == NROW * K && (int)H.size() == NCOL * K);
+
+    ofstream export_file(file_output, ios::out);
+    if (export_file.is_open()) {
+        export_file << NROW << " " << NCOL << " " << K << endl;
+        export_file << setprecision(numeric_limits<double>::max_digits10);
+        for (const vector<double> *F : {&W, &H}) {
+            for (int i = 0; i < (int)F->size() / K; i++) {
+                for (int k = 0; k < K; k++)
+                    export_file << (*F)[i * K + k] << " ";
+                export_file << endl;
+            }
+        }
+    }
+    export_file.close();
+}
+
+//
+// @brief: Read a factor model written by write_model
+//
+bool read_model(const string file_input, int &NROW, int &NCOL, int &K,
+                vector<double> &W, vector<double> &H) {
+    ifstream data_file(file_input, ios::in);
+    if (!(data_file >> NROW >> NCOL >> K) || NROW <= 0 || NCOL <= 0 || K <= 0)
+        return false;
+
+    W.resize(NROW * K);
+    H.resize(NCOL * K);
+    for (auto &v : W)
+        data_file >> v;
+    for (auto &v : H)
+        data_file >> v;
+    return (bool)data_file;
+}
+
+//
+// @brief: Read a delta of ratings, one "user_idx item_idx value" per line.
+// A value of 0 removes the rating
+//
+bool read_delta(const string file_input, vector<Rating> &delta) {
+    ifstream data_file(file_input, ios::in);
+    if (data_file.is_open() == false)
+        return false;
+
+    Rating rating;
+    while (data_file >> rating.user_idx >> rating.item_idx >> rating.value) {
+        if (rating.user_idx < 0 || rating.item_idx < 0)
+            return false;
+        delta.push_back(rating);
+    }
+    return data_file.eof();
+}
+
+//
+// @brief: Apply a delta of ratings to the rating matrix. Indices beyond the
+// matrix add new rows (users) or columns (items). The rows and columns of
+// every rating in the delta are marked as touched
+//
+void apply_delta(const vector<Rating> &delta, int &NROW, int &NCOL,
+                 vector<vector<double>> &arr_data, vector<int> &row_count,
+                 vector<char> &touched_rows, vector<char> &touched_cols) {
+    for (auto &rating : delta) {
+        NROW = max(NROW, rating.user_idx + 1);
+        NCOL = max(NCOL, rating.item_idx + 1);
+    }
+    arr_data.resize(NROW);
+    for (auto &row : arr_data)
+        row.resize(NCOL, 0.0);
+
+    touched_rows.assign(NROW, 0);
+    touched_cols.assign(NCOL, 0);
+    for (auto &rating : delta) {
+        arr_data[rating.user_idx][rating.item_idx] = rating.value;
+        touched_rows[rating.user_idx] = 1;
+        touched_cols[rating.item_idx] = 1;
+    }
+
+    row_count.assign(NROW, 0);
+    for (int i = 0; i < NROW; i++)
+        row_count[i] = (int)count_if(arr_data[i].begin(), arr_data[i].end(), [](double v) { return v != 0.0; });
+}
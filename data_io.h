@@ -0,0 +1,59 @@
+//
+// @file    : data_io.h
+// @purpose : Reading, writing and partitioning of the rating matrix
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 03/07/2020
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DATA_IO_H_
+#define DATA_IO_H_
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+using namespace std;
+
+//
+// @brief: A single observed rating A[user_idx][item_idx] = value
+//
+struct Rating {
+    int     user_idx;
+    int     item_idx;
+    double  value;
+};
+
+void                    read_data(const string file_input, int &NROW, int &NCOL,
+                                  vector<vector<double>> &arr_data, vector<int> &row_count);
+void                    write_data(const string file_output, vector<vector<double>> &arr_data);
+void                    assert_matrix_size(vector<vector<double>> &mat, int nRows, int nCols);
+vector<vector<int>>     split_array_index(const vector<int> &arr, int num_segment);
+string                  sibling_path(const string file, const string prefix);
+
+// Lists of ratings in the MovieLens format "user_id item_id rating [timestamp]" (ids from 1)
+bool                    read_rating_list(const string file_input, vector<Rating> &ratings);
+
+// Factor models and rating deltas for incremental training
+void                    write_model(const string file_output, int NROW, int NCOL, int K,
+                                    const vector<double> &W, const vector<double> &H);
+bool                    read_model(const string file_input, int &NROW, int &NCOL, int &K,
+                                   vector<double> &W, vector<double> &H);
+bool                    read_delta(const string file_input, vector<Rating> &delta);
+void                    apply_delta(const vector<Rating> &delta, int &NROW, int &NCOL,
+                                    vector<vector<double>> &arr_data, vector<int> &row_count,
+                                    vector<char> &touched_rows, vector<char> &touched_cols);
+
+#endif // DATA_IO_H_
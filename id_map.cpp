@@ -0,0 +1,153 @@
+//
+// @file    : id_map.cpp
+// @purpose : A implementation class for the dictionary of external user/item ids
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "id_map.h"
+#include <fstream>
+#include <cassert>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Open-addressing hash map
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+IdMap::IdMap(size_t expected_size) {
+    size_t capacity = 16;
+    while (capacity < 2 * expected_size)
+        capacity <<= 1;
+    this->slot_keys.assign(capacity, 0);
+    this->slot_values.assign(capacity, -1);
+    this->mask = capacity - 1;
+}
+
+//
+// @brief: The value of key, inserted with 'value' when the key is new
+//
+int IdMap::insert(uint64_t key, int value) {
+    assert(value >= 0);
+    if (2 * (this->num_keys + 1) > this->slot_values.size())
+        this->grow();
+
+    size_t slot = splitmix64(key) & this->mask;
+    while (this->slot_values[slot] >= 0) {
+        if (this->slot_keys[slot] == key)
+            return this->slot_values[slot];
+        slot = (slot + 1) & this->mask;
+    }
+    this->slot_keys[slot] = key;
+    this->slot_values[slot] = value;
+    this->num_keys++;
+    return value;
+}
+
+//
+// @brief: The keys in the map, in slot order
+//
+vector<uint64_t> IdMap::keys() const {
+    vector<uint64_t> keys;
+    keys.reserve(this->num_keys);
+    for (size_t slot = 0; slot < this->slot_values.size(); slot++)
+        if (this->slot_values[slot] >= 0)
+            keys.push_back(this->slot_keys[slot]);
+    return keys;
+}
+
+//
+// @brief: Double the capacity and insert the keys again
+//
+void IdMap::grow() {
+    vector<uint64_t> old_keys;
+    vector<int> old_values;
+    old_keys.swap(this->slot_keys);
+    old_values.swap(this->slot_values);
+
+    *this = IdMap(old_values.size());
+    for (size_t slot = 0; slot < old_values.size(); slot++)
+        if (old_values[slot] >= 0)
+            this->insert(old_keys[slot], old_values[slot]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Dictionary
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Index the keys: key -> row, key -> column
+//
+void IdDictionary::build_index() {
+    this->user_index = IdMap(this->user_keys.size());
+    for (int i = 0; i < (int)this->user_keys.size(); i++)
+        this->user_index.insert(this->user_keys[i], i);
+    this->item_index = IdMap(this->item_keys.size());
+    for (int j = 0; j < (int)this->item_keys.size(); j++)
+        this->item_index.insert(this->item_keys[j], j);
+}
+
+//
+// @brief: The row of a user key, a new last row when the key is new
+//
+int IdDictionary::add_user(uint64_t key) {
+    int user_idx = this->user_index.insert(key, (int)this->user_keys.size());
+    if (user_idx == (int)this->user_keys.size())
+        this->user_keys.push_back(key);
+    return user_idx;
+}
+
+//
+// @brief: The column of an item key, a new last column when the key is new
+//
+int IdDictionary::add_item(uint64_t key) {
+    int item_idx = this->item_index.insert(key, (int)this->item_keys.size());
+    if (item_idx == (int)this->item_keys.size())
+        this->item_keys.push_back(key);
+    return item_idx;
+}
+
+bool write_id_dictionary(const string file_output, const IdDictionary &dictionary) {
+    ofstream export_file(file_output, ios::out);
+    if (export_file.is_open() == false)
+        return false;
+
+    export_file << dictionary.user_keys.size() << " " << dictionary.item_keys.size() << "\n";
+    for (uint64_t key : dictionary.user_keys)
+        export_file << key << "\n";
+    for (uint64_t key : dictionary.item_keys)
+        export_file << key << "\n";
+    return export_file.good();
+}
+
+bool read_id_dictionary(const string file_input, IdDictionary &dictionary) {
+    ifstream data_file(file_input, ios::in);
+    int NROW, NCOL;
+    if (data_file.is_open() == false || !(data_file >> NROW >> NCOL) || NROW < 0 || NCOL < 0)
+        return false;
+
+    dictionary.user_keys.resize(NROW);
+    dictionary.item_keys.resize(NCOL);
+    for (auto &key : dictionary.user_keys)
+        if (!(data_file >> key))
+            return false;
+    for (auto &key : dictionary.item_keys)
+        if (!(data_file >> key))
+            return false;
+    dictionary.build_index();
+    return dictionary.user_index.size() == (size_t)NROW && dictionary.item_index.size() == (size_t)NCOL;
+}
+
+bool read_keyed_delta(const string file_input, IdDictionary &dictionary, vector<Rating> &delta) {
+    ifstream data_file(file_input, ios::in);
+    if (data_file.is_open() == false)
+        return false;
+
+    uint64_t user_key, item_key;
+    double value;
+    while (data_file >> user_key >> item_key >> value)
+        delta.push_back(Rating{dictionary.add_user(user_key), dictionary.add_item(item_key), value});
+    return data_file.eof();
+}
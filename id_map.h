@@ -0,0 +1,86 @@
+//
+// @file    : id_map.h
+// @purpose : A definition class for the dictionary of external user/item ids
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ID_MAP_H_
+#define ID_MAP_H_
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "rng.h"
+#include "data_io.h"
+using namespace std;
+
+//
+// @brief: Open-addressing hash map from 64-bit external ids to dense
+// indices: linear probing in two flat arrays of a power-of-2 capacity, kept
+// at most half full. A slot is empty when its value is -1, so that every
+// key, 0 included, can be stored
+//
+class IdMap {
+
+public:
+    IdMap()                                 : IdMap(16) {}
+    explicit IdMap(size_t expected_size);
+    IdMap(const IdMap& old)                 = default;
+    IdMap& operator=(const IdMap& old)      = default;
+    IdMap(IdMap&& old)                      = default;
+    IdMap& operator=(IdMap&& old)           = default;
+
+    int                     find(uint64_t key) const {
+        for (size_t slot = splitmix64(key) & this->mask; ; slot = (slot + 1) & this->mask) {
+            if (this->slot_values[slot] < 0)
+                return -1;
+            if (this->slot_keys[slot] == key)
+                return this->slot_values[slot];
+        }
+    }
+    int                     insert(uint64_t key, int value);
+    size_t                  size() const { return this->num_keys; }
+    vector<uint64_t>        keys() const;
+
+private:
+    void                    grow();
+
+    vector<uint64_t>                                slot_keys;
+    vector<int>                                     slot_values;
+    size_t                                          mask            { 0 };
+    size_t                                          num_keys        { 0 };
+};
+
+//
+// @brief: External ids of the rows (users) and columns (items) of a rating
+// matrix: the dense index of a key is its position in the sorted keys, so
+// that the dictionary does not depend on the order of the ratings. Keys
+// added by an incremental delta follow, in their order in the delta
+//
+struct IdDictionary {
+    vector<uint64_t>                                user_keys;      // key of each row
+    vector<uint64_t>                                item_keys;      // key of each column
+    IdMap                                           user_index;
+    IdMap                                           item_index;
+
+    void                    build_index();
+    int                     add_user(uint64_t key);
+    int                     add_item(uint64_t key);
+};
+
+// Dictionary files: "NROW NCOL", then the NROW user keys and the NCOL item keys, one per line
+bool                    write_id_dictionary(const string file_output, const IdDictionary &dictionary);
+bool                    read_id_dictionary(const string file_input, IdDictionary &dictionary);
+
+// Delta of ratings by external ids: one "user_id item_id value" per line; new ids extend the dictionary
+bool                    read_keyed_delta(const string file_input, IdDictionary &dictionary, vector<Rating> &delta);
+
+#endif // ID_MAP_H_
@@ -5,7 +5,7 @@
 // @project : NOMAD algorithm for matrix completion with UPCXX
 // @licensed: N/A
 // @created : 03/07/2020
-// @modified: 09/07/2020
+// @modified: 19/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -21,37 +21,110 @@
 #include <cmath>
 #include <ctime>
 #include "worker.h"
+#include "data_io.h"
+#include "memory_policy.h"
+#include "regression.h"
+#include "shard_loader.h"
+#include "id_map.h"
 #include <upcxx/upcxx.hpp>
 #define bug(x) cout << #x << " = " << x << endl
 using namespace std;
 
-void read_data(const string file_input, int &NROW, int &NCOL,
-               vector<vector<double>> &arr_data, vector<int> &row_count);
-void write_data(const string file_output, vector<vector<double>> &arr_data);
-void assert_matrix_size(vector<vector<double>> &mat, int nRows, int nCols);
-vector<vector<int>> split_array_index(const vector<int> &arr, int num_segment);
-
 // Argument:
 //  + argv[1]   =   file_input (char*, e.g. "matrix.txt")
 //  + argv[2]   =   NUM_EPOCHS (int, e.g. 1000)
+//  + argv[3]   =   SOLVER (optional, "nomad" | "als" | "ccd" | "incremental", default "nomad")
+//  + argv[4]   =   ROUTING (optional, "hier" | "flat", default "hier", for "nomad" only)
+//  + argv[5]   =   CODEC (optional, "none" | "fp32" | "fp16" | "bf16" | "int8", default "none")
+//  + argv[6]   =   INIT (optional, "random" | "mean" | "svd", default "random")
+//  + argv[7]   =   TARGET_RMSE (optional, report the first epoch reaching this train RMSE, default 0 = off)
+// Incremental training from the model "model_[file_input]" of a previous run:
+//  + argv[2]   =   NUM_PASSES (int, passes of NOMAD over the touched items)
+//  + argv[3]   =   "incremental"
+//  + argv[4]   =   DELTA_FILE (char*, one "user_idx item_idx value" per line)
+// Environment:
+//  + NOMAD_PAGES   =   page size of A and update_step, advised for W and H ("4k" | "2m" | "1g", default "4k")
+//  + NOMAD_TRACE   =   file of the token-flow timeline (Chrome trace / Perfetto JSON, default off)
+//  + NOMAD_TRACE_SAMPLE = trace 1 in N tokens (default 1)
+//  + NOMAD_TRACE_EVENTS = ring capacity per process (default 1048576 records)
+//  + NOMAD_SEED    =   reproducible run: seeds derived from this value and a lockstep ring
+//                      schedule, so that runs with the same number of processes give the same factors
+//  + NOMAD_BASELINE =  run record to compare this run with (written when the file does not exist)
+//  + NOMAD_BASELINE_TOLERANCE = allowed slowdown of the training time (default 0.10)
+//  + NOMAD_OVERLAP_LOAD = "0" waits for every rating before the first update (default: NOMAD with
+//                      random init starts on the resident ratings while the others arrive)
 int main(int argc, char **argv) {
     // Collect program arguments
     if (argc < 3)
         exit(0);
     const string file_input(argv[1]);
     long long int NUM_EPOCHS = atoll(argv[2]);
+    const string solver = (argc > 3) ? string(argv[3]) : string("nomad");
+    if (solver != "nomad" && solver != "als" && solver != "ccd" && solver != "incremental")
+        exit(0);
+    const bool incremental = (solver == "incremental");
+    const bool use_nomad = (solver == "nomad" || incremental);
+    if (incremental && argc < 5)
+        exit(0);
+    const string delta_file = incremental ? string(argv[4]) : string("");
+    const string routing = (argc > 4 && !incremental) ? string(argv[4]) : string("hier");
+    if (routing != "hier" && routing != "flat")
+        exit(0);
+    WireCodec codec;
+    if (parse_wire_codec((argc > 5 && !incremental) ? string(argv[5]) : string("none"), codec) == false)
+        exit(0);
+    const string init = (argc > 6 && !incremental) ? string(argv[6]) : string("random");
+    InitMode init_mode;
+    if (init == "random")
+        init_mode = InitMode::UNIFORM;
+    else if (init == "mean")
+        init_mode = InitMode::ITEM_MEAN;
+    else if (init == "svd")
+        init_mode = InitMode::SVD;
+    else
+        exit(0);
+    double target_rmse = (argc > 7 && !incremental) ? atof(argv[7]) : 0.0;
+    auto program_start = std::chrono::steady_clock::now();
 
     // Predefined params for sparse matrix input
-    int NROW, NCOL;
-    vector<vector<double>> mat_data;
+    int NROW = 0, NCOL = 0;
+    vector<vector<double>> mat_data;        // whole matrix, for incremental training only
     vector<int> num_element_row;
 
-    // Read input matrix as data
-    read_data(file_input, NROW, NCOL, mat_data, num_element_row);
-    assert_matrix_size(mat_data, NROW, NCOL);
-
-    // Define matrix completion kernel: K = max(1, dim/6)
-    int K_embeddings = max(1, (int)((0.5 * (NROW + NCOL)) / 3.0));
+    // Incremental training: the previous model of file_input plus the delta.
+    // The outputs are named after the merged ratings "merged_[DELTA_FILE]"
+    string output_base = file_input;
+    int K_embeddings = 0;
+    int model_users = 0, model_items = 0;
+    vector<double> W_model, H_model;
+    vector<char> touched_users, touched_items;
+    IdDictionary dictionary;                // external ids of the rows and columns, when known
+    bool has_dictionary = false;
+    if (incremental) {
+        read_data(file_input, NROW, NCOL, mat_data, num_element_row);
+        assert_matrix_size(mat_data, NROW, NCOL);
+        if (read_model(sibling_path(file_input, "model_"), model_users, model_items, K_embeddings,
+                       W_model, H_model) == false || model_users != NROW || model_items != NCOL)
+            exit(0);
+
+        // A matrix with a dictionary (ids_[INPUT_FILE]) takes a delta by external
+        // ids, whose new ids extend the dictionary; a stale dictionary is an error
+        vector<Rating> delta;
+        if (read_id_dictionary(sibling_path(file_input, "ids_"), dictionary)) {
+            if ((int)dictionary.user_keys.size() != NROW || (int)dictionary.item_keys.size() != NCOL) {
+                fprintf(stderr, "Dictionary %s does not match %s (%zu x %zu ids for %d x %d)\n",
+                        sibling_path(file_input, "ids_").c_str(), file_input.c_str(),
+                        dictionary.user_keys.size(), dictionary.item_keys.size(), NROW, NCOL);
+                exit(1);
+            }
+            has_dictionary = true;
+        }
+        if ((has_dictionary ? read_keyed_delta(delta_file, dictionary, delta)
+                            : read_delta(delta_file, delta)) == false)
+            exit(0);
+        apply_delta(delta, NROW, NCOL, mat_data, num_element_row, touched_users, touched_items);
+        output_base = sibling_path(delta_file, "merged_");
+    }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // MAIN PROCESS  --  Starts from here
@@ -60,15 +133,41 @@ int main(int argc, char **argv) {
     // Premilinary definition
     upcxx::init();
     int num_proc = upcxx::rank_n();
+    const MemoryPolicy memory_policy = memory_policy_from_env();
+
+    // Every process parses a shard of the input and streams its ratings to
+    // the owners of their rows, which split the rows of W into 'num_worker'
+    // parts balanced by ratings; the rows move into the worker without copy
+    ShardLoader loader;
+    if (incremental) {
+        loader.start(mat_data, num_element_row, memory_policy);
+    } else {
+        // Every process agrees on the outcome, so all of them exit together
+        if (loader.start(file_input, memory_policy) == false) {
+            upcxx::finalize();
+            exit(0);
+        }
+        NROW = loader.get_num_rows();
+        NCOL = loader.get_num_cols();
 
-    // Split rows of W into 'num_worker' parts using a simple naive approach
-    vector<vector<int>> split_row_index = split_array_index(num_element_row, num_proc);
+        // Define matrix completion kernel: K = max(1, dim/6)
+        K_embeddings = max(1, (int)((0.5 * (NROW + NCOL)) / 3.0));
+    }
 
-    // Store usr_idx and corresponding rows in W, A in each process.
-    vector<vector<double>> segments_A;
-    for (auto user_index : split_row_index[upcxx::rank_me()])
-        segments_A.push_back(mat_data[user_index]);
-    assert_matrix_size(segments_A, split_row_index[upcxx::rank_me()].size(), NCOL);
+    // Reproducible runs take every seed from NOMAD_SEED, other runs from the clock
+    const char *seed_env = getenv("NOMAD_SEED");
+    const bool reproducible = (seed_env != nullptr);
+    uint64_t run_seed = reproducible ? strtoull(seed_env, nullptr, 10)
+                                     : (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+
+    // NOMAD with random factors starts right after the count pass: the
+    // ratings are parsed and shipped between the first epochs, and SGD picks
+    // them up as they land in A; the other modes read every rating at init
+    const char *overlap_env = getenv("NOMAD_OVERLAP_LOAD");
+    bool loading = use_nomad && !incremental && !reproducible && init_mode == InitMode::UNIFORM &&
+                   (overlap_env == nullptr || string(overlap_env) != "0");
+    if (loading == false)
+        loader.wait();
 
     // Initialize worker object as upcxx::dist_object
     // double alpha_rate = 0.013;   // for self-generated-data
@@ -77,21 +176,91 @@ int main(int argc, char **argv) {
     double alpha_rate = 0.01;      // for movielen-100k-data
     double beta_rate = 0.015;
     double lambda_rate = 0.0015;
+    int ccd_inner_iters = 3;        // for CCD++ only
+    double hot_factor = 4.0;        // split items rated more than 4x the average
+    long long int reconcile_every = 1000;
+    if (use_nomad == false)
+        lambda_rate = 0.05;         // ALS and CCD++ scale lambda by the number of ratings
     upcxx::dist_object<Worker> worker(Worker(upcxx::rank_me(), 
                                              NROW, NCOL, K_embeddings,
                                              alpha_rate, beta_rate, lambda_rate,
-                                             split_row_index[upcxx::rank_me()], segments_A));
+                                             loader.take_user_index(), loader.take_A(),
+                                             memory_policy));
+
+    if (reproducible) {
+        worker->set_reproducible(run_seed);
+        if (upcxx::rank_me() == 0)
+            printf(">\tReproducible run: seed=%llu, lockstep ring schedule\n", (unsigned long long)run_seed);
+    }
+
+    // Wait for the late ratings before anything reading all of them
+    auto finish_loading = [&loader, &worker, &loading]() {
+        if (loading) {
+            loader.wait();
+            worker->finish_loading();
+            loading = false;
+        }
+    };
+
+    // Initialize W and H in parallel, every process fills its own rows
+    auto init_start = std::chrono::steady_clock::now();
+    if (incremental) {
+        // Start from the previous model, fold in the new users and items,
+        // and let SGD move the rows of the touched users only
+        worker->load_factors(W_model, H_model, model_users, model_items);
+        worker->fold_in(model_users, model_items);
+        worker->freeze_users(touched_users);
+    } else {
+        worker->initialize_factors(init_mode, run_seed);
+    }
+    double init_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - init_start).count();
+    double init_rmse = loading ? 0.0 : worker->compute_train_rmse();
+    if (upcxx::rank_me() == 0) {
+        if (incremental)
+            printf(">\tFold-in of %d new user(s) and %d new item(s) in %.3fs, train RMSE = %.4f\n",
+                   NROW - model_users, NCOL - model_items, init_time, init_rmse);
+        else if (loading)
+            printf(">\tInit=%s in %.3fs, train RMSE pending (ratings still arriving)\n", init.c_str(), init_time);
+        else
+            printf(">\tInit=%s in %.3fs, train RMSE = %.4f\n", init.c_str(), init_time, init_rmse);
+    }
 
-    // Initialize item queue of each worker randomly
+    // Set up the scheduling and the routing of item tokens before any token is queued
+    if (use_nomad) {
+        worker->setup_scheduling(loader.get_item_count(), hot_factor);
+        worker->setup_routing(routing == "hier", codec);
+        if (incremental)
+            worker->set_fifo_queues();
+    }
+
+    // Initialize item queue of each worker randomly, or round-robin on the
+    // lockstep ring (only the touched items circulate in incremental training)
     std::default_random_engine generator(time(NULL));
     std::uniform_int_distribution<int> distribution(0, num_proc - 1);
-    for (int i = 0; i < NCOL; i++) {
-        int receiver_id = distribution(generator);
+    long long int num_queued = 0;
+    for (int i = 0; i < worker->get_num_tokens() && use_nomad; i++) {
+        if (incremental && touched_items[worker->get_token_item(i)] == 0)
+            continue;
+        int receiver_id = (reproducible || incremental) ? (int)(num_queued % num_proc) : distribution(generator);
         if (upcxx::rank_me() == receiver_id)
             worker->add_item_idx_to_queue(i);
+        num_queued++;
         upcxx::barrier();
     }
 
+    // A serve only updates the users of the item on one process, so a pass
+    // takes every queued token through all the processes. The tokens travel
+    // on the lockstep ring and every queue is FIFO (set_fifo_queues): a
+    // process holding at most ceil(num_queued / num_proc) tokens serves each
+    // of them within that many rounds, so ceil(num_queued / num_proc) *
+    // num_proc rounds give every token num_proc serves, one on each process
+    if (incremental) {
+        NUM_EPOCHS *= (num_queued + num_proc - 1) / num_proc * num_proc;
+        if (upcxx::rank_me() == 0)
+            printf(">\tIncremental training: %d touched user(s), %lld token(s), %lld epochs\n",
+                   (int)count(touched_users.begin(), touched_users.end(), 1), num_queued, NUM_EPOCHS);
+    }
+
     // Print to test the distributing procedure
     // for (int i = 0; i < num_proc; i++) {
     //     if (upcxx::rank_me() == i) {
@@ -104,14 +273,96 @@ int main(int argc, char **argv) {
     //////////////////////////
     // Model update
     //////////////////////////
-    for (long long int epoch = 0; epoch < NUM_EPOCHS; epoch++) {
-        if (upcxx::rank_me() == 0 && ((epoch % 200) == 0 || epoch == (NUM_EPOCHS-1) ))
-            printf("-----| Epoch #%09lld\n", epoch);
-        
-        worker->update(epoch + 1);
+    // Trace the token flow of NOMAD when asked
+    const char *trace_file = getenv("NOMAD_TRACE");
+    if (use_nomad && trace_file != nullptr) {
+        const char *trace_sample = getenv("NOMAD_TRACE_SAMPLE");
+        const char *trace_events = getenv("NOMAD_TRACE_EVENTS");
+        worker->setup_tracing(trace_events ? atoll(trace_events) : (1 << 20), trace_sample ? atoi(trace_sample) : 1);
     }
 
     upcxx::barrier();
+    double first_update_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - program_start).count();
+    first_update_time = upcxx::reduce_all(first_update_time, upcxx::op_fast_max).wait();
+    if (upcxx::rank_me() == 0)
+        printf(">\tTime to first update = %.3fs%s\n", first_update_time,
+               loading ? " (ratings still arriving)" : "");
+    TlbMissCounter tlb_counter;
+    tlb_counter.start();
+    double train_time = 0.0;
+    long long int target_epoch = -1;
+    for (long long int epoch = 0; epoch < NUM_EPOCHS; epoch++) {
+        // Parse and ship 1 MB more of the shard of this process between two updates
+        if (loading && loader.pump((size_t)1 << 20) && loader.is_resident())
+            finish_loading();
+        auto epoch_start = std::chrono::steady_clock::now();
+
+        if (use_nomad) {
+            if (upcxx::rank_me() == 0 && ((epoch % 200) == 0 || epoch == (NUM_EPOCHS-1) ))
+                printf("-----| Epoch #%09lld\n", epoch);
+
+            if (reproducible || incremental)
+                worker->update_lockstep(epoch + 1);
+            else
+                worker->update(epoch + 1);
+
+            // Average the replicated rows of the hot items
+            if ((epoch + 1) % reconcile_every == 0)
+                worker->reconcile_hot_items();
+            train_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count();
+
+            // Checkpoint the train RMSE (collective) when a target is set
+            if (target_rmse > 0.0 && target_epoch < 0 && (epoch + 1) % reconcile_every == 0) {
+                finish_loading();
+                worker->synchronize_H();
+                if (worker->compute_train_rmse() <= target_rmse)
+                    target_epoch = epoch + 1;
+            }
+        } else {
+            if (solver == "als")
+                worker->update_als(epoch + 1);
+            else
+                worker->update_ccd(epoch + 1, ccd_inner_iters);
+            train_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count();
+
+            // ALS and CCD++ sweeps are collective, so report the RMSE of every sweep
+            double rmse = worker->compute_train_rmse();
+            if (upcxx::rank_me() == 0)
+                printf("-----| Epoch #%09lld\tRMSE = %.4f\ttime = %.3fs\n", epoch, rmse, train_time);
+            if (target_rmse > 0.0 && target_epoch < 0 && rmse <= target_rmse)
+                target_epoch = epoch + 1;
+        }
+    }
+
+    long long int tlb_misses = tlb_counter.stop();
+    if (use_nomad)
+        worker->wait_for_stragglers();
+    finish_loading();
+    loader.report();
+
+    // Collect the rows of H spread over the nodes into H of proc-0
+    if (use_nomad)
+        worker->reconcile_hot_items();
+    worker->synchronize_H();
+
+    // Report the training RMSE and wall clock of the selected solver
+    double train_rmse = worker->compute_train_rmse();
+    if (upcxx::rank_me() == 0)
+        printf(">\tSolver=%s: %lld epochs in %.3fs, train RMSE = %.4f\n",
+               solver.c_str(), NUM_EPOCHS, train_time, train_rmse);
+    if (target_rmse > 0.0 && upcxx::rank_me() == 0) {
+        if (target_epoch > 0)
+            printf(">\tInit=%s: train RMSE <= %.4f after %lld epochs\n", init.c_str(), target_rmse, target_epoch);
+        else
+            printf(">\tInit=%s: train RMSE <= %.4f not reached in %lld epochs\n", init.c_str(), target_rmse, NUM_EPOCHS);
+    }
+    if (use_nomad) {
+        worker->report_transfer_stats(train_time);
+        worker->report_idle_time();
+    }
+    worker->report_memory_stats(train_time, tlb_misses);
+    if (use_nomad && trace_file != nullptr)
+        worker->export_trace(string(trace_file));
 
     // Print to test the distributing procedure
     // for (int i = 0; i < num_proc; i++) {
@@ -122,16 +373,45 @@ int main(int argc, char **argv) {
     //     upcxx::barrier();
     // }
 
-    // Print to test the predicted matrix A to file
+    // Print to test the predicted matrix A to file, and keep the model for
+    // incremental training (with the merged ratings it was trained on)
+    int exit_code = 0;
     if (upcxx::rank_me() == 0) {
         vector<vector<double>> A_pred = worker->compute_approximate_A();
+        write_data(sibling_path(output_base, "out_"), A_pred);
+        vector<double> W_final = worker->gather_W();
+        vector<double> H_final = worker->gather_H();
+        write_model(sibling_path(output_base, "model_"), NROW, NCOL, K_embeddings, W_final, H_final);
+
+        // Keep the external ids of the input (ids_[INPUT_FILE]) next to the model,
+        // and next to the merged ratings for the next refresh
+        if (incremental == false)
+            has_dictionary = read_id_dictionary(sibling_path(file_input, "ids_"), dictionary) &&
+                             (int)dictionary.user_keys.size() == NROW && (int)dictionary.item_keys.size() == NCOL;
+        if (has_dictionary)
+            write_id_dictionary(sibling_path(sibling_path(output_base, "model_"), "ids_"), dictionary);
+        if (incremental) {
+            write_data(output_base, mat_data);
+            if (has_dictionary)
+                write_id_dictionary(sibling_path(output_base, "ids_"), dictionary);
+        }
 
-        std::size_t found = file_input.find_last_of("/\\");
-        string _path_ = file_input.substr(0,found);
-        string _file_ = file_input.substr(found+1);
-        string file_output = _path_ + "/out_" + _file_;
-
-        write_data(file_output, A_pred);
+        // Regression harness: compare with the stored baseline, or store this run as the baseline
+        RunRecord run { incremental ? delta_file : file_input, solver, routing, wire_codec_name(codec), init,
+                        hot_factor, num_proc, NUM_EPOCHS, K_embeddings, reproducible, reproducible ? run_seed : 0,
+                        train_time, train_rmse, factor_checksum(W_final, H_final) };
+        if (reproducible)
+            printf(">\tFactor checksum = %016llx\n", (unsigned long long)run.checksum);
+        const char *baseline_file = getenv("NOMAD_BASELINE");
+        const char *time_tolerance = getenv("NOMAD_BASELINE_TOLERANCE");
+        RunRecord baseline;
+        if (baseline_file != nullptr && read_run_record(string(baseline_file), baseline)) {
+            if (compare_with_baseline(run, baseline, time_tolerance ? atof(time_tolerance) : 0.10) == false)
+                exit_code = 2;
+        } else if (baseline_file != nullptr) {
+            write_run_record(string(baseline_file), run);
+            printf(">\tRegression: baseline written to %s\n", baseline_file);
+        }
     }
     upcxx::finalize();
 
@@ -139,93 +419,5 @@ int main(int argc, char **argv) {
     // MAIN PROCESS  --  Ends at here
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    return 0;
-}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Subsidiary functions
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-// @brief: Read the input data into pass matrix
-//
-void read_data(const string file_input, int &NROW, int &NCOL,
-               vector<vector<double>> &arr_data, vector<int> &row_count) {
-    // Init file stream
-    ifstream data_file(file_input, ios::in);
-
-    // Read data
-    if (data_file.is_open()) {
-        data_file >> NROW >> NCOL;
-        arr_data.resize(NROW);
-        row_count = vector<int>(NROW, 0);
-
-        for (int i = 0; i < NROW; i++) {
-            for (int j = 0; j < NCOL; j++) {
-                double v;
-                data_file >> v;
-                arr_data[i].push_back(v);
-                if (v != 0)
-                    row_count[i]++;
-            }
-        }
-    }
-
-    data_file.close();
-}
-
-//
-// @brief: Write output matrix into export file
-//
-void write_data(const string file_output, vector<vector<double>> &arr_data) {
-    // Init file stream
-    ofstream export_file(file_output, ios::out);
-    export_file << arr_data.size() << " " << arr_data[0].size() << endl;
-    
-    // Read data
-    if (export_file.is_open()) {
-        for (auto row : arr_data) {
-            for (auto v : row) 
-                export_file << fixed << setprecision(2) << v << "  ";
-            export_file << endl;
-        }
-    }
-
-    export_file.close();
-}
-
-//
-// @brief: Read the input data into pass matrix
-//
-void assert_matrix_size(vector<vector<double>> &mat, int nRows, int nCols) {
-    assert(mat.size() == nRows);
-    for (auto row : mat)
-        assert(row.size() == nCols);
-}
-
-//
-// @brief: Split the input array into K least-size-different parts
-//
-vector<vector<int>> split_array_index(const vector<int> &arr, int num_segment) {
-    assert(num_segment <= (int)arr.size());
-
-    vector<pair<int, int>> input_arr;
-    for (int i = 0; i < arr.size(); i++) {
-        input_arr.push_back(make_pair(arr[i], i));
-    }
-
-    sort(input_arr.begin(), input_arr.end(), greater<pair<int, int>>());
-
-    vector<vector<int>> ans(num_segment);
-    vector<int> sum(num_segment, 0);
-
-    for (auto v : input_arr) {
-        int min_val = *min_element(sum.begin(), sum.end());
-        vector<int>::iterator it = find(sum.begin(), sum.end(), min_val);
-        int min_pos = it - sum.begin();
-
-        sum[min_pos] += v.first;
-        ans[min_pos].push_back(v.second);
-    }
-
-    return ans;
+    return exit_code;
 }
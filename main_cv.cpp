@@ -0,0 +1,252 @@
+//
+// @file    : main_cv.cpp
+// @purpose : A k-fold cross-validation runner over the shared-memory trainer
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include "shm_trainer.h"
+#include "data_io.h"
+using namespace std;
+
+//
+// @brief: One fold: the positions of its test ratings in the full rating
+// set (the other ratings are its training set), the held-out ratings missing
+// from the full set (tested by this fold only, trained by no fold) and its results
+//
+struct Fold {
+    string                                          name;
+    vector<int>                                     test_index;
+    vector<Rating>                                  extra_test;
+    int                                             num_train       { 0 };
+    double                                          train_rmse      { 0.0 };
+    double                                          test_rmse       { 0.0 };
+    double                                          train_time      { 0.0 };
+};
+
+//
+// @brief: Split a comma-separated list
+//
+static vector<string> split_list(const string &list) {
+    vector<string> items;
+    stringstream in(list);
+    string item;
+    while (getline(in, item, ','))
+        if (item.empty() == false)
+            items.push_back(item);
+    return items;
+}
+
+//
+// @brief: Train fold 'fold' on the full rating set without its test ratings,
+// then evaluate it on its test ratings
+//
+static void run_fold(Fold &fold, const vector<Rating> &ratings, int num_users, int num_items,
+                     int num_embeddings, int num_epochs, int threads_per_fold,
+                     double alpha, double beta, double lambda) {
+    auto start = std::chrono::steady_clock::now();
+    vector<char> is_test(ratings.size(), 0);
+    vector<Rating> test;
+    for (int p : fold.test_index) {
+        is_test[p] = 1;
+        test.push_back(ratings[p]);
+    }
+    test.insert(test.end(), fold.extra_test.begin(), fold.extra_test.end());
+    vector<Rating> train;
+    train.reserve(ratings.size() - test.size());
+    for (int p = 0; p < (int)ratings.size(); p++)
+        if (is_test[p] == 0)
+            train.push_back(ratings[p]);
+    fold.num_train = (int)train.size();
+
+    SharedMemoryTrainer trainer(partition_ratings(train, num_users, num_items, threads_per_fold),
+                                num_embeddings, alpha, beta, lambda, 2020u);
+    train.clear();
+    train.shrink_to_fit();
+    trainer.train_nomad_ring(num_epochs);
+
+    fold.train_rmse = trainer.compute_train_rmse();
+    fold.test_rmse = trainer.compute_rmse(test);
+    fold.train_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Argument:
+//  + argv[1]   =   RATINGS (char*, comma-separated files whose union is the full rating set,
+//                  e.g. "u1.base,u1.test", MovieLens format "user_id item_id rating [timestamp]")
+//  + argv[2]   =   FOLDS (char*, comma-separated test files of the folds, e.g. "u1.test,u2.test",
+//                  or "random:K" for K random folds)
+//  + argv[3]   =   NUM_EPOCHS (optional, default 20)
+//  + argv[4]   =   NUM_THREADS (optional, default std::thread::hardware_concurrency())
+//  + argv[5]   =   THREADS_PER_FOLD (optional, default 1)
+//  + argv[6]   =   K_EMBEDDINGS (optional, default max(1, (NUM_USERS + NUM_ITEMS) / 6))
+int main(int argc, char **argv) {
+    // Collect program arguments
+    if (argc < 3)
+        exit(0);
+    vector<string> rating_files = split_list(string(argv[1]));
+    const string fold_spec(argv[2]);
+    int NUM_EPOCHS = (argc > 3) ? atoi(argv[3]) : 20;
+    int NUM_THREADS = (argc > 4) ? atoi(argv[4]) : max(1, (int)thread::hardware_concurrency());
+    int THREADS_PER_FOLD = (argc > 5) ? atoi(argv[5]) : 1;
+    if (rating_files.empty() || NUM_EPOCHS <= 0 || NUM_THREADS <= 0 || THREADS_PER_FOLD <= 0)
+        exit(0);
+
+    // Per-epoch learning rate: lr = alpha / (1 + beta * sqrt(epoch)), as NOMAD-SHM
+    double alpha_rate = 0.01;       // for movielen-100k-data
+    double beta_rate = 0.1;
+    double lambda_rate = 0.05;
+
+    //////////////////////////
+    // Full rating set, parsed once
+    //////////////////////////
+    auto load_start = std::chrono::steady_clock::now();
+    vector<Rating> ratings;
+    unordered_map<long long int, int> position;     // (user_idx, item_idx) -> position in ratings
+    auto key_of = [](const Rating &r) { return ((long long int)r.user_idx << 32) | (unsigned)r.item_idx; };
+    for (auto &file : rating_files) {
+        vector<Rating> part;
+        if (read_rating_list(file, part) == false) {
+            fprintf(stderr, "Cannot read %s\n", file.c_str());
+            exit(1);
+        }
+        for (auto &rating : part) {
+            auto found = position.find(key_of(rating));
+            if (found != position.end()) {
+                ratings[found->second].value = rating.value;
+            } else {
+                position[key_of(rating)] = (int)ratings.size();
+                ratings.push_back(rating);
+            }
+        }
+    }
+
+    // Folds: the test files only name which ratings are held out; a held-out
+    // rating missing from RATINGS is tested by its fold only, with a warning,
+    // so that every fold trains on the same full set
+    long long int num_added = 0;
+    vector<Fold> folds;
+    if (fold_spec.compare(0, 7, "random:") == 0) {
+        int num_folds = atoi(fold_spec.c_str() + 7);
+        if (num_folds < 2)
+            exit(0);
+        vector<int> order(ratings.size());
+        for (int p = 0; p < (int)order.size(); p++)
+            order[p] = p;
+        std::default_random_engine random_engine(2020u);
+        shuffle(order.begin(), order.end(), random_engine);
+        folds.resize(num_folds);
+        for (int f = 0; f < num_folds; f++)
+            folds[f].name = "fold-" + to_string(f + 1);
+        for (int p = 0; p < (int)order.size(); p++)
+            folds[p % num_folds].test_index.push_back(order[p]);
+    } else {
+        for (auto &file : split_list(fold_spec)) {
+            vector<Rating> test;
+            if (read_rating_list(file, test) == false) {
+                fprintf(stderr, "Cannot read %s\n", file.c_str());
+                exit(1);
+            }
+            Fold fold;
+            fold.name = file.substr(file.find_last_of("/\\") + 1);
+            for (auto &rating : test) {
+                auto found = position.find(key_of(rating));
+                if (found != position.end()) {
+                    fold.test_index.push_back(found->second);
+                } else {
+                    fold.extra_test.push_back(rating);
+                    num_added++;
+                }
+            }
+            folds.push_back(fold);
+        }
+    }
+    position.clear();
+    if (num_added > 0)
+        fprintf(stderr, ">\tWarning: %lld held-out rating(s) missing from RATINGS are tested by their fold "
+                "only, and trained by no fold\n", num_added);
+
+    int NROW = 0, NCOL = 0;
+    for (auto &rating : ratings) {
+        NROW = max(NROW, rating.user_idx + 1);
+        NCOL = max(NCOL, rating.item_idx + 1);
+    }
+    for (auto &fold : folds) {
+        for (auto &rating : fold.extra_test) {
+            NROW = max(NROW, rating.user_idx + 1);
+            NCOL = max(NCOL, rating.item_idx + 1);
+        }
+    }
+    double load_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+
+    int K_embeddings = (argc > 6) ? atoi(argv[6]) : max(1, (int)((0.5 * (NROW + NCOL)) / 3.0));
+    THREADS_PER_FOLD = min(THREADS_PER_FOLD, NROW);
+    if (folds.empty() || K_embeddings <= 0 || K_embeddings >= min(NROW, NCOL))
+        exit(0);
+    int num_slots = max(1, NUM_THREADS / THREADS_PER_FOLD);
+    printf(">\tCross-validation: %d ratings of %d users x %d items loaded in %.3fs, %d fold(s), "
+           "K=%d, %d epochs, %d fold(s) at a time with %d thread(s) each\n",
+           (int)ratings.size(), NROW, NCOL, load_time, (int)folds.size(),
+           K_embeddings, NUM_EPOCHS, num_slots, THREADS_PER_FOLD);
+
+    //////////////////////////
+    // Train the folds concurrently
+    //////////////////////////
+    auto cv_start = std::chrono::steady_clock::now();
+    atomic<int> next { 0 };
+    vector<thread> slots;
+    for (int s = 0; s < min(num_slots, (int)folds.size()); s++) {
+        slots.emplace_back([&]() {
+            for (int f = next++; f < (int)folds.size(); f = next++)
+                run_fold(folds[f], ratings, NROW, NCOL, K_embeddings, NUM_EPOCHS, THREADS_PER_FOLD,
+                         alpha_rate, beta_rate, lambda_rate);
+        });
+    }
+    for (auto &th : slots)
+        th.join();
+    double cv_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - cv_start).count();
+
+    //////////////////////////
+    // Report
+    //////////////////////////
+    printf("%-12s %8s %8s %11s %11s %10s\n", "fold", "train", "test", "train_RMSE", "test_RMSE", "time(s)");
+    // Folds without held-out ratings have no test RMSE and stay out of the mean
+    double mean = 0.0, sq = 0.0;
+    int num_scored = 0;
+    for (auto &fold : folds) {
+        int num_test = (int)(fold.test_index.size() + fold.extra_test.size());
+        if (num_test == 0) {
+            printf("%-12s %8d %8d %11.4f %11s %10.3f\n", fold.name.c_str(), fold.num_train,
+                   0, fold.train_rmse, "-", fold.train_time);
+            continue;
+        }
+        printf("%-12s %8d %8d %11.4f %11.4f %10.3f\n", fold.name.c_str(), fold.num_train,
+               num_test, fold.train_rmse, fold.test_rmse, fold.train_time);
+        mean += fold.test_rmse;
+        sq += fold.test_rmse * fold.test_rmse;
+        num_scored++;
+    }
+    if (num_scored == 0) {
+        printf(">\tNo fold has held-out ratings (in %.3fs, load %.3fs)\n", cv_time, load_time);
+        return 1;
+    }
+    mean /= num_scored;
+    double stddev = sqrt(max(0.0, sq / num_scored - mean * mean));
+    printf(">\tMean test RMSE = %.4f +/- %.4f over %d fold(s) in %.3fs (load %.3fs)\n",
+           mean, stddev, num_scored, cv_time, load_time);
+
+    return 0;
+}
@@ -0,0 +1,362 @@
+//
+// @file    : main_serve.cpp
+// @purpose : A top-N recommendation server over the trained factors, with an approximate MIPS index
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "model_store.h"
+#include "mips_index.h"
+#include "id_map.h"
+#include "data_io.h"
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Query protocol
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Answer one query line:
+//  + "user <user_idx> <N>"  ->  "ok j:score j:score ..."  (top N items for the user)
+//  + "item <item_idx> <N>"  ->  "ok j:score j:score ..."  (top N items for h_j, without j)
+//  + anything else          ->  "error <reason>"
+// With the dictionary of the model, the users and items of the queries and
+// of the replies are their external ids instead of their indices
+//
+static string answer_query(const string &line, const MappedModel &model, const HnswIndex &index, int ef_search,
+                           const IdDictionary *dictionary) {
+    istringstream in(line);
+    string kind;
+    uint64_t key;
+    int N;
+    if (!(in >> kind >> key >> N) || N <= 0)
+        return "error expected: user|item <idx> <N>";
+
+    int idx = (int)min(key, (uint64_t)INT32_MAX);
+    if (dictionary != nullptr && kind == "user")
+        idx = dictionary->user_index.find(key);
+    else if (dictionary != nullptr && kind == "item")
+        idx = dictionary->item_index.find(key);
+
+    const double *query;
+    int exclude_item = -1;
+    if (kind == "user" && 0 <= idx && idx < model.get_num_users()) {
+        query = model.W_row(idx);
+    } else if (kind == "item" && 0 <= idx && idx < model.get_num_items()) {
+        query = model.H_row(idx);
+        exclude_item = idx;
+    } else {
+        return "error unknown " + kind + " " + to_string(key);
+    }
+
+    string reply = "ok";
+    char buffer[64];
+    for (auto &scored : index.search(query, N, max(ef_search, N), exclude_item)) {
+        if (dictionary != nullptr)
+            snprintf(buffer, sizeof(buffer), " %llu:%.4f",
+                     (unsigned long long)dictionary->item_keys[scored.first], scored.second);
+        else
+            snprintf(buffer, sizeof(buffer), " %d:%.4f", scored.first, scored.second);
+        reply += buffer;
+    }
+    return reply;
+}
+
+//
+// @brief: Fixed pool of query threads shared by every connection and the
+// benchmark. A batch is cut into slices queued on the pool, so concurrent
+// connections share the same threads instead of each starting its own
+//
+class QueryPool {
+
+public:
+    explicit QueryPool(int num_threads) {
+        for (int t = 0; t < num_threads; t++)
+            this->threads.emplace_back([this]() { this->work(); });
+    }
+    QueryPool(const QueryPool& old)         = delete;
+    QueryPool& operator=(const QueryPool& old) = delete;
+    ~QueryPool() {
+        {
+            lock_guard<mutex> lock(this->queue_mutex);
+            this->stopping = true;
+        }
+        this->queue_ready.notify_all();
+        for (auto &th : this->threads)
+            th.join();
+    }
+
+    int                     size() const { return (int)this->threads.size(); }
+
+    //
+    // @brief: Run task(0), ..., task(num_tasks - 1) on the pool and return
+    // once all of them are done
+    //
+    void                    run_all(int num_tasks, const function<void(int)> &task) {
+        mutex done_mutex;
+        condition_variable all_done;
+        int remaining = num_tasks;
+        {
+            lock_guard<mutex> lock(this->queue_mutex);
+            for (int t = 0; t < num_tasks; t++) {
+                this->tasks.push_back([&, t]() {
+                    task(t);
+                    lock_guard<mutex> done_lock(done_mutex);
+                    if (--remaining == 0)
+                        all_done.notify_one();
+                });
+            }
+        }
+        this->queue_ready.notify_all();
+
+        unique_lock<mutex> done_lock(done_mutex);
+        all_done.wait(done_lock, [&]() { return remaining == 0; });
+    }
+
+private:
+    void                    work() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(this->queue_mutex);
+                this->queue_ready.wait(lock, [this]() { return this->stopping || this->tasks.empty() == false; });
+                if (this->tasks.empty())
+                    return;
+                task = std::move(this->tasks.front());
+                this->tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    vector<thread>                                  threads;
+    deque<function<void()>>                         tasks;
+    mutex                                           queue_mutex;
+    condition_variable                              queue_ready;
+    bool                                            stopping        { false };
+};
+
+//
+// @brief: Answer a batch of query lines, in one slice per thread of the pool
+//
+static vector<string> answer_batch(const vector<string> &lines, const MappedModel &model,
+                                   const HnswIndex &index, int ef_search, QueryPool &pool,
+                                   const IdDictionary *dictionary) {
+    vector<string> replies(lines.size());
+    int T = min(pool.size(), (int)lines.size());
+    pool.run_all(T, [&](int t) {
+        for (int q = t; q < (int)lines.size(); q += T)
+            replies[q] = answer_query(lines[q], model, index, ef_search, dictionary);
+    });
+    return replies;
+}
+
+//
+// @brief: Serve the queries of one stream: every read() returns the lines
+// already sent by the client, which are answered as one batch in order
+//
+static void serve_stream(int in_fd, int out_fd, const MappedModel &model,
+                         const HnswIndex &index, int ef_search, QueryPool &pool,
+                         const IdDictionary *dictionary) {
+    string pending;
+    char chunk[1 << 16];
+    while (true) {
+        ssize_t got = read(in_fd, chunk, sizeof(chunk));
+        if (got <= 0)
+            break;
+        pending.append(chunk, got);
+
+        vector<string> lines;
+        size_t start = 0, end;
+        while ((end = pending.find('\n', start)) != string::npos) {
+            if (end > start)
+                lines.push_back(pending.substr(start, end - start));
+            start = end + 1;
+        }
+        pending.erase(0, start);
+        if (lines.empty())
+            continue;
+
+        string out;
+        for (auto &reply : answer_batch(lines, model, index, ef_search, pool, dictionary))
+            out += reply + "\n";
+        for (size_t sent = 0; sent < out.size(); ) {
+            ssize_t put = write(out_fd, out.data() + sent, out.size() - sent);
+            if (put <= 0)
+                return;
+            sent += put;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Latency percentile (in microseconds) of sorted latencies
+//
+static double percentile(const vector<double> &sorted_us, double p) {
+    return sorted_us[min((size_t)(p * sorted_us.size()), sorted_us.size() - 1)];
+}
+
+//
+// @brief: Latency and recall@N of the index against exact scoring, for
+// several beam widths, on 'num_queries' random users; then the throughput
+// of batched queries
+//
+static void run_benchmark(const MappedModel &model, const HnswIndex &index,
+                          int num_queries, int N, QueryPool &pool, const IdDictionary *dictionary) {
+    std::default_random_engine random_engine(12345);
+    std::uniform_int_distribution<int> pick_user(0, model.get_num_users() - 1);
+    vector<int> users(num_queries);
+    for (auto &u : users)
+        u = pick_user(random_engine);
+
+    // Exact scoring of every item, as compute_approximate_A does
+    vector<vector<pair<int, double>>> exact(num_queries);
+    vector<double> latency_us(num_queries);
+    for (int q = 0; q < num_queries; q++) {
+        auto start = std::chrono::steady_clock::now();
+        exact[q] = exact_top_n(model.H_data(), model.get_num_items(), model.get_num_embeddings(),
+                               model.W_row(users[q]), N, -1);
+        latency_us[q] = std::chrono::duration<double, micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    sort(latency_us.begin(), latency_us.end());
+    printf(">\tExact       : p50 = %8.1fus, p99 = %8.1fus, recall@%d = 1.0000\n",
+           percentile(latency_us, 0.50), percentile(latency_us, 0.99), N);
+
+    for (int ef : {N, 2 * N, 5 * N, 10 * N, 20 * N}) {
+        double hits = 0.0;
+        for (int q = 0; q < num_queries; q++) {
+            auto start = std::chrono::steady_clock::now();
+            vector<pair<int, double>> approx = index.search(model.W_row(users[q]), N, ef, -1);
+            latency_us[q] = std::chrono::duration<double, micro>(std::chrono::steady_clock::now() - start).count();
+
+            for (auto &a : approx)
+                for (auto &e : exact[q])
+                    hits += (a.first == e.first);
+        }
+        sort(latency_us.begin(), latency_us.end());
+        printf(">\tHNSW ef=%-4d: p50 = %8.1fus, p99 = %8.1fus, recall@%d = %.4f\n",
+               ef, percentile(latency_us, 0.50), percentile(latency_us, 0.99), N,
+               hits / ((double)num_queries * N));
+    }
+
+    // Batched queries over the threads of the pool
+    vector<string> lines;
+    for (int u : users)
+        lines.push_back("user " + to_string(dictionary ? dictionary->user_keys[u] : (uint64_t)u) + " " + to_string(N));
+    auto start = std::chrono::steady_clock::now();
+    answer_batch(lines, model, index, 10 * N, pool, dictionary);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf(">\tBatch of %d queries, ef=%d, %d threads: %.3e queries/s\n",
+           num_queries, 10 * N, pool.size(), num_queries / max(elapsed, 1e-9));
+}
+
+// Argument:
+//  + argv[1]   =   MODEL_FILE (char*, e.g. "model_matrix.txt", written by NOMAD-UPC)
+//  + argv[2]   =   MODE (optional, "stdin" | "socket" | "bench", default "stdin")
+//  + argv[3]   =   SOCKET_PATH for "socket" | NUM_QUERIES for "bench" (default 1000)
+//  + argv[4]   =   N for "bench" (optional, default 10)
+// The dictionary "ids_[MODEL_FILE]" written next to the model, when present,
+// maps the external user/item ids of the queries and replies
+int main(int argc, char **argv) {
+    // Collect program arguments
+    if (argc < 2)
+        exit(0);
+    const string file_model(argv[1]);
+    const string mode = (argc > 2) ? string(argv[2]) : string("stdin");
+    if (mode != "stdin" && mode != "socket" && mode != "bench")
+        exit(0);
+    if (mode == "socket" && argc < 4)
+        exit(0);
+
+    // HNSW parameters
+    int M_links = 16;
+    int ef_construction = 200;
+    int ef_search = 100;
+    int num_threads = max(1, (int)thread::hardware_concurrency());
+
+    // Map the factors and build the index over the rows of H
+    MappedModel model;
+    if (MappedModel::open_or_convert(model, file_model) == false) {
+        fprintf(stderr, "Cannot load model %s\n", file_model.c_str());
+        exit(1);
+    }
+    IdDictionary ids;
+    const IdDictionary *dictionary = nullptr;
+    if (read_id_dictionary(sibling_path(file_model, "ids_"), ids)) {
+        if ((int)ids.user_keys.size() != model.get_num_users() || (int)ids.item_keys.size() != model.get_num_items()) {
+            fprintf(stderr, "Dictionary %s does not match the model\n", sibling_path(file_model, "ids_").c_str());
+            exit(1);
+        }
+        dictionary = &ids;
+        fprintf(stderr, ">\tDictionary: users and items by external id\n");
+    }
+    auto build_start = std::chrono::steady_clock::now();
+    HnswIndex index(model.H_data(), model.get_num_items(), model.get_num_embeddings(),
+                    M_links, ef_construction, 2020u);
+    double build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+    fprintf(stderr, ">\tModel: %d users, %d items, K=%d; HNSW built in %.3fs (%d levels, %lld links)\n",
+            model.get_num_users(), model.get_num_items(), model.get_num_embeddings(),
+            build_time, index.get_max_level() + 1, index.get_num_links());
+
+    // Every query is answered by the same threads, whatever the number of connections
+    QueryPool pool(num_threads);
+    if (mode == "bench") {
+        int num_queries = (argc > 3) ? atoi(argv[3]) : 1000;
+        int N = (argc > 4) ? atoi(argv[4]) : 10;
+        if (num_queries <= 0 || N <= 0)
+            exit(0);
+        run_benchmark(model, index, num_queries, min(N, model.get_num_items()), pool, dictionary);
+    } else if (mode == "stdin") {
+        serve_stream(STDIN_FILENO, STDOUT_FILENO, model, index, ef_search, pool, dictionary);
+    } else {
+        // One reader thread per connection on a Unix domain socket, the queries
+        // of all connections being answered by the pool
+        const string socket_path(argv[3]);
+        int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socket_path.c_str());
+        if (server_fd < 0 || ::bind(server_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(server_fd, 64) != 0) {
+            fprintf(stderr, "Cannot listen on %s\n", socket_path.c_str());
+            exit(1);
+        }
+        fprintf(stderr, ">\tListening on %s\n", socket_path.c_str());
+
+        while (true) {
+            int client_fd = accept(server_fd, nullptr, nullptr);
+            if (client_fd < 0)
+                continue;
+            thread([client_fd, &model, &index, ef_search, &pool, dictionary]() {
+                serve_stream(client_fd, client_fd, model, index, ef_search, pool, dictionary);
+                close(client_fd);
+            }).detach();
+        }
+    }
+
+    return 0;
+}
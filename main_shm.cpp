@@ -0,0 +1,95 @@
+//
+// @file    : main_shm.cpp
+// @purpose : A single-node demo of NOMAD / Hogwild with std::thread (no UPCXX runtime)
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "shm_trainer.h"
+#include "data_io.h"
+#include "memory_policy.h"
+using namespace std;
+
+// Argument:
+//  + argv[1]   =   file_input (char*, e.g. "matrix.txt")
+//  + argv[2]   =   NUM_EPOCHS (int, e.g. 50)
+//  + argv[3]   =   NUM_THREADS (optional, default std::thread::hardware_concurrency())
+//  + argv[4]   =   MODE (optional, "nomad" | "hogwild", default "nomad")
+// Environment:
+//  + NOMAD_PAGES   =   page size of W and H ("4k" | "2m" | "1g", default "4k")
+//  + NOMAD_NUMA    =   NUMA placement ("default" | "first-touch" | "interleave", default "default")
+int main(int argc, char **argv) {
+    // Collect program arguments
+    if (argc < 3)
+        exit(0);
+    const string file_input(argv[1]);
+    int NUM_EPOCHS = atoi(argv[2]);
+    int NUM_THREADS = (argc > 3) ? atoi(argv[3]) : max(1, (int)thread::hardware_concurrency());
+    const string mode = (argc > 4) ? string(argv[4]) : string("nomad");
+    if (mode != "nomad" && mode != "hogwild")
+        exit(0);
+
+    // Read input matrix as data
+    int NROW, NCOL;
+    vector<vector<double>> mat_data;
+    vector<int> num_element_row;
+    read_data(file_input, NROW, NCOL, mat_data, num_element_row);
+    assert_matrix_size(mat_data, NROW, NCOL);
+    NUM_THREADS = min(NUM_THREADS, NROW);
+
+    // Define matrix completion kernel: K = max(1, dim/6)
+    int K_embeddings = max(1, (int)((0.5 * (NROW + NCOL)) / 3.0));
+
+    // Per-epoch learning rate: lr = alpha / (1 + beta * sqrt(epoch))
+    double alpha_rate = 0.01;       // for movielen-100k-data
+    double beta_rate = 0.1;
+    double lambda_rate = 0.05;
+    unsigned random_seed = std::chrono::system_clock::now().time_since_epoch().count();
+    SharedMemoryTrainer trainer(NUM_THREADS, NROW, NCOL, K_embeddings,
+                                alpha_rate, beta_rate, lambda_rate,
+                                mat_data, random_seed, memory_policy_from_env());
+
+    //////////////////////////
+    // Model update
+    //////////////////////////
+    TlbMissCounter tlb_counter;
+    tlb_counter.start();
+    auto train_start = std::chrono::steady_clock::now();
+    if (mode == "nomad")
+        trainer.train_nomad_ring(NUM_EPOCHS);
+    else
+        trainer.train_hogwild(NUM_EPOCHS);
+    double train_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - train_start).count();
+    long long int tlb_misses = tlb_counter.stop();
+
+    printf(">\tMode=%s: %d epochs, %d threads in %.3fs, %.3e updates/s, train RMSE = %.4f\n",
+           mode.c_str(), NUM_EPOCHS, NUM_THREADS, train_time,
+           trainer.get_num_updates() / max(train_time, 1e-9), trainer.compute_train_rmse());
+    if (tlb_misses >= 0)
+        printf(">\tdTLB load misses = %lld, %.3f per update\n",
+               tlb_misses, (double)tlb_misses / max(1LL, trainer.get_num_updates()));
+    else
+        printf(">\tdTLB load misses: not available (perf_event_open refused)\n");
+
+    // Print the predicted matrix A to file
+    vector<vector<double>> A_pred = trainer.compute_approximate_A();
+
+    std::size_t found = file_input.find_last_of("/\\");
+    string _path_ = file_input.substr(0,found);
+    string _file_ = file_input.substr(found+1);
+    string file_output = _path_ + "/out_" + _file_;
+
+    write_data(file_output, A_pred);
+
+    return 0;
+}
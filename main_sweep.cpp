@@ -0,0 +1,230 @@
+//
+// @file    : main_sweep.cpp
+// @purpose : A hyperparameter sweep with successive halving over the shared-memory trainer
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <limits>
+#include <map>
+#include <cmath>
+#include "shm_trainer.h"
+#include "data_io.h"
+using namespace std;
+
+//
+// @brief: One configuration of the sweep and its model replica
+//
+struct Trial {
+    double                                          alpha;
+    double                                          beta;
+    double                                          lambda;
+    int                                             K;
+    unique_ptr<SharedMemoryTrainer>                 trainer;
+    double                                          val_rmse        { numeric_limits<double>::infinity() };
+    int                                             epochs          { 0 };      // epochs trained when val_rmse was measured
+    double                                          train_time      { 0.0 };
+};
+
+//
+// @brief: Parse a grid "alpha=0.005,0.01;beta=0.1;lambda=0.02,0.05;K=16,64"
+// (missing keys keep their default values)
+//
+static bool parse_grid(const string &spec, map<string, vector<double>> &grid) {
+    stringstream entries(spec);
+    string entry;
+    while (getline(entries, entry, ';')) {
+        size_t eq = entry.find('=');
+        if (eq == string::npos || grid.count(entry.substr(0, eq)) == 0)
+            return false;
+        vector<double> values;
+        stringstream list(entry.substr(eq + 1));
+        string value;
+        while (getline(list, value, ','))
+            values.push_back(atof(value.c_str()));
+        if (values.empty())
+            return false;
+        grid[entry.substr(0, eq)] = values;
+    }
+    return true;
+}
+
+//
+// @brief: Train every trial of 'alive' up to 'budget' epochs and evaluate it
+// on the validation ratings, running 'num_slots' trials at a time
+//
+static void run_rung(vector<Trial> &trials, const vector<int> &alive, int budget, int num_slots,
+                     shared_ptr<const RatingPartition> partition, const vector<Rating> &validation) {
+    atomic<int> next { 0 };
+    vector<thread> slots;
+    for (int s = 0; s < min(num_slots, (int)alive.size()); s++) {
+        slots.emplace_back([&]() {
+            for (int p = next++; p < (int)alive.size(); p = next++) {
+                Trial &trial = trials[alive[p]];
+                auto start = std::chrono::steady_clock::now();
+                if (trial.trainer == nullptr)
+                    trial.trainer.reset(new SharedMemoryTrainer(partition, trial.K, trial.alpha, trial.beta,
+                                                                trial.lambda, 1000u + alive[p]));
+                trial.trainer->train_nomad_ring(budget - trial.trainer->get_num_epochs());
+                // A diverged trial (NaN or infinite RMSE) ranks last, so the sorts stay well defined
+                trial.val_rmse = trial.trainer->compute_rmse(validation);
+                if (isfinite(trial.val_rmse) == false)
+                    trial.val_rmse = numeric_limits<double>::infinity();
+                trial.epochs = trial.trainer->get_num_epochs();
+                trial.train_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+        });
+    }
+    for (auto &th : slots)
+        th.join();
+}
+
+// Argument:
+//  + argv[1]   =   file_input (char*, e.g. "matrix.txt")
+//  + argv[2]   =   VALIDATION (optional, a matrix file like file_input, or "-" to hold out 10% of the ratings)
+//  + argv[3]   =   GRID (optional, e.g. "alpha=0.005,0.01;beta=0.1;lambda=0.02,0.05;K=16,64")
+//  + argv[4]   =   MIN_EPOCHS (optional, epochs of the first rung, default 5)
+//  + argv[5]   =   MAX_EPOCHS (optional, epochs of the last rung, default 45)
+//  + argv[6]   =   ETA (optional, 1/ETA of the trials survive each rung, default 3)
+//  + argv[7]   =   NUM_THREADS (optional, default std::thread::hardware_concurrency())
+//  + argv[8]   =   THREADS_PER_TRIAL (optional, default 1)
+int main(int argc, char **argv) {
+    // Collect program arguments
+    if (argc < 2)
+        exit(0);
+    const string file_input(argv[1]);
+    const string file_validation = (argc > 2) ? string(argv[2]) : string("-");
+    map<string, vector<double>> grid = {
+        {"alpha",   {0.005, 0.01, 0.02}},
+        {"beta",    {0.1}},
+        {"lambda",  {0.02, 0.05, 0.1}},
+        {"K",       {}},
+    };
+    int MIN_EPOCHS = (argc > 4) ? atoi(argv[4]) : 5;
+    int MAX_EPOCHS = (argc > 5) ? atoi(argv[5]) : 45;
+    int ETA = (argc > 6) ? atoi(argv[6]) : 3;
+    int NUM_THREADS = (argc > 7) ? atoi(argv[7]) : max(1, (int)thread::hardware_concurrency());
+    int THREADS_PER_TRIAL = (argc > 8) ? atoi(argv[8]) : 1;
+    if (MIN_EPOCHS <= 0 || MAX_EPOCHS < MIN_EPOCHS || ETA < 2 || NUM_THREADS <= 0 || THREADS_PER_TRIAL <= 0)
+        exit(0);
+
+    // Read and partition the ratings once, for all trials
+    auto load_start = std::chrono::steady_clock::now();
+    int NROW, NCOL;
+    vector<vector<double>> mat_data;
+    vector<int> num_element_row;
+    read_data(file_input, NROW, NCOL, mat_data, num_element_row);
+    assert_matrix_size(mat_data, NROW, NCOL);
+
+    vector<Rating> ratings = ratings_of_matrix(mat_data);
+    vector<Rating> validation;
+    if (file_validation == "-") {
+        std::default_random_engine random_engine(2020u);
+        shuffle(ratings.begin(), ratings.end(), random_engine);
+        validation.assign(ratings.begin(), ratings.begin() + ratings.size() / 10);
+        ratings.erase(ratings.begin(), ratings.begin() + ratings.size() / 10);
+    } else {
+        int VROW, VCOL;
+        vector<vector<double>> val_data;
+        vector<int> val_count;
+        read_data(file_validation, VROW, VCOL, val_data, val_count);
+        if (VROW != NROW || VCOL != NCOL)
+            exit(0);
+        validation = ratings_of_matrix(val_data);
+    }
+    mat_data.clear();
+    mat_data.shrink_to_fit();
+
+    THREADS_PER_TRIAL = min(THREADS_PER_TRIAL, NROW);
+    shared_ptr<const RatingPartition> partition = partition_ratings(ratings, NROW, NCOL, THREADS_PER_TRIAL);
+    double load_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+
+    // Grid of configurations: K defaults to the K of NOMAD-UPC and fractions of it
+    int K_default = max(1, (int)((0.5 * (NROW + NCOL)) / 3.0));
+    grid["K"] = {(double)max(1, K_default / 8), (double)max(1, K_default / 2), (double)K_default};
+    if (argc > 3 && parse_grid(string(argv[3]), grid) == false)
+        exit(0);
+
+    vector<Trial> trials;
+    for (double alpha : grid["alpha"])
+        for (double beta : grid["beta"])
+            for (double lambda : grid["lambda"])
+                for (double K : grid["K"])
+                    if (0 < (int)K && (int)K < min(NROW, NCOL))
+                        trials.push_back(Trial{alpha, beta, lambda, (int)K, nullptr});
+
+    int num_slots = max(1, NUM_THREADS / THREADS_PER_TRIAL);
+    printf(">\tSweep: %d configuration(s), %d training / %d validation ratings loaded in %.3fs, "
+           "%d trial(s) at a time with %d thread(s) each\n",
+           (int)trials.size(), (int)ratings.size(), (int)validation.size(), load_time,
+           num_slots, THREADS_PER_TRIAL);
+
+    //////////////////////////
+    // Successive halving
+    //////////////////////////
+    auto sweep_start = std::chrono::steady_clock::now();
+    vector<int> alive(trials.size());
+    for (int t = 0; t < (int)trials.size(); t++)
+        alive[t] = t;
+    for (int budget = MIN_EPOCHS, rung = 0; alive.empty() == false; budget = min(budget * ETA, MAX_EPOCHS), rung++) {
+        run_rung(trials, alive, budget, num_slots, partition, validation);
+
+        // Keep the best 1/ETA of the trials for the next rung
+        sort(alive.begin(), alive.end(), [&trials](int a, int b) { return trials[a].val_rmse < trials[b].val_rmse; });
+        printf("-----| Rung #%d: %d trial(s) at %d epochs, best validation RMSE = %.4f\ttime = %.3fs\n",
+               rung, (int)alive.size(), budget, trials[alive[0]].val_rmse,
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - sweep_start).count());
+        if (budget >= MAX_EPOCHS)
+            break;
+        alive.resize(max(1, (int)(alive.size() + ETA - 1) / ETA));
+
+        // Free the replicas of the stopped trials
+        vector<char> kept(trials.size(), 0);
+        for (int t : alive)
+            kept[t] = 1;
+        for (int t = 0; t < (int)trials.size(); t++)
+            if (kept[t] == 0)
+                trials[t].trainer.reset();
+    }
+
+    //////////////////////////
+    // Leaderboard
+    //////////////////////////
+    // Trials that went further rank first, then by validation RMSE
+    vector<int> order(trials.size());
+    for (int t = 0; t < (int)trials.size(); t++)
+        order[t] = t;
+    stable_sort(order.begin(), order.end(), [&trials](int a, int b) {
+        if (trials[a].epochs != trials[b].epochs)
+            return trials[a].epochs > trials[b].epochs;
+        return trials[a].val_rmse < trials[b].val_rmse;
+    });
+
+    const string file_output = sibling_path(file_input, "sweep_");
+    ofstream export_file(file_output, ios::out);
+    export_file << "rank,alpha,beta,lambda,K,epochs,val_rmse,train_time" << endl;
+    printf("%5s %9s %9s %9s %6s %7s %10s %10s\n", "rank", "alpha", "beta", "lambda", "K", "epochs", "val_RMSE", "time(s)");
+    for (int r = 0; r < (int)order.size(); r++) {
+        Trial &trial = trials[order[r]];
+        printf("%5d %9.4g %9.4g %9.4g %6d %7d %10.4f %10.3f\n", r + 1, trial.alpha, trial.beta, trial.lambda,
+               trial.K, trial.epochs, trial.val_rmse, trial.train_time);
+        export_file << r + 1 << "," << trial.alpha << "," << trial.beta << "," << trial.lambda << ","
+                    << trial.K << "," << trial.epochs << "," << trial.val_rmse << "," << trial.train_time << endl;
+    }
+    export_file.close();
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+//
+// @file    : memory_policy.cpp
+// @purpose : A implementation for the page-size and NUMA placement policies of the factor and rating storage
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "memory_policy.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+static const size_t PAGE_2MB = (size_t)1 << 21;
+static const size_t PAGE_1GB = (size_t)1 << 30;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Policy selection
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Parse a page size ("4k" | "2m" | "1g") and a NUMA placement
+// ("default" | "first-touch" | "interleave")
+//
+bool parse_memory_policy(const string &pages, const string &numa, MemoryPolicy &policy) {
+    if (pages == "4k" || pages == "default")
+        policy.page_size = PageSize::DEFAULT;
+    else if (pages == "2m")
+        policy.page_size = PageSize::HUGE_2MB;
+    else if (pages == "1g")
+        policy.page_size = PageSize::HUGE_1GB;
+    else
+        return false;
+
+    if (numa == "default")
+        policy.numa = NumaPlacement::DEFAULT;
+    else if (numa == "first-touch")
+        policy.numa = NumaPlacement::FIRST_TOUCH;
+    else if (numa == "interleave")
+        policy.numa = NumaPlacement::INTERLEAVE;
+    else
+        return false;
+    return true;
+}
+
+//
+// @brief: The policy selected by NOMAD_PAGES and NOMAD_NUMA (the default
+// policy when they are unset or invalid)
+//
+MemoryPolicy memory_policy_from_env() {
+    const char *pages = getenv("NOMAD_PAGES");
+    const char *numa = getenv("NOMAD_NUMA");
+    MemoryPolicy policy;
+    if (parse_memory_policy(pages ? pages : "4k", numa ? numa : "default", policy) == false) {
+        fprintf(stderr, "Ignoring NOMAD_PAGES=%s NOMAD_NUMA=%s\n", pages ? pages : "", numa ? numa : "");
+        policy = MemoryPolicy();
+    }
+    return policy;
+}
+
+string memory_policy_name(const MemoryPolicy &policy) {
+    string name = (policy.page_size == PageSize::HUGE_1GB) ? "pages=1g" :
+                  (policy.page_size == PageSize::HUGE_2MB) ? "pages=2m" : "pages=4k";
+    name += (policy.numa == NumaPlacement::INTERLEAVE) ? ", numa=interleave" :
+            (policy.numa == NumaPlacement::FIRST_TOUCH) ? ", numa=first-touch" : ", numa=default";
+    return name;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Topology
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Online NUMA nodes, from a list such as "0-1,3"
+//
+static vector<int> get_online_nodes() {
+    vector<int> nodes;
+    ifstream file("/sys/devices/system/node/online");
+    string list, range;
+    if (!(file >> list))
+        return vector<int>(1, 0);
+    stringstream ranges(list);
+    while (getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for (int node = first; node <= last; node++)
+            nodes.push_back(node);
+    }
+    return nodes.empty() ? vector<int>(1, 0) : nodes;
+}
+
+int get_num_numa_nodes() {
+    return (int)get_online_nodes().size();
+}
+
+//
+// @brief: Pin the calling thread to the thread_id-th CPU it may run on
+// (modulo their number)
+//
+bool pin_thread_to_cpu(int thread_id) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+        return false;
+
+    int target = thread_id % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t single;
+            CPU_ZERO(&single);
+            CPU_SET(cpu, &single);
+            return pthread_setaffinity_np(pthread_self(), sizeof(single), &single) == 0;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Mappings
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Whether transparent huge pages may be used on madvise()d ranges
+//
+static bool transparent_huge_pages_enabled() {
+    ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    string setting;
+    getline(file, setting);
+    return setting.empty() == false && setting.find("[never]") == string::npos;
+}
+
+//
+// @brief: An anonymous mapping of 'bytes' from the hugetlb pool of pages
+// of 2^page_shift bytes, or nullptr when the pool cannot provide them
+//
+static void* map_hugetlb(size_t bytes, int page_shift) {
+    void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT), -1, 0);
+    return (ptr == MAP_FAILED) ? nullptr : ptr;
+}
+
+//
+// @brief: An anonymous mapping of 'bytes' (a multiple of 2MB) aligned on
+// 2MB, so that transparent huge pages can back all of it
+//
+static void* map_aligned_2mb(size_t bytes) {
+    void *raw = mmap(nullptr, bytes + PAGE_2MB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return nullptr;
+    uintptr_t start = (uintptr_t)raw;
+    uintptr_t aligned = (start + PAGE_2MB - 1) & ~(uintptr_t)(PAGE_2MB - 1);
+    if (aligned > start)
+        munmap(raw, aligned - start);
+    if (start + PAGE_2MB > aligned)
+        munmap((void *)(aligned + bytes), start + PAGE_2MB - aligned);
+    return (void *)aligned;
+}
+
+//
+// @brief: Map 'bytes' of zeroed memory with the requested page size, falling
+// back to smaller pages when the larger ones are not available; with
+// 'interleave', the pages are spread over the online NUMA nodes
+//
+bool map_with_policy(size_t bytes, PageSize page_size, bool interleave, PolicyMapping &mapping) {
+    mapping = PolicyMapping();
+    if (bytes == 0)
+        return true;
+
+    if (page_size == PageSize::HUGE_1GB && bytes >= PAGE_1GB / 2) {
+        size_t length = (bytes + PAGE_1GB - 1) & ~(PAGE_1GB - 1);
+        if ((mapping.base = map_hugetlb(length, 30)) != nullptr) {
+            mapping.bytes = length;
+            mapping.granted = "1GB hugetlb";
+        }
+    }
+    if (mapping.base == nullptr && page_size != PageSize::DEFAULT && bytes >= PAGE_2MB) {
+        size_t length = (bytes + PAGE_2MB - 1) & ~(PAGE_2MB - 1);
+        if ((mapping.base = map_hugetlb(length, 21)) != nullptr) {
+            mapping.bytes = length;
+            mapping.granted = "2MB hugetlb";
+        } else if ((mapping.base = map_aligned_2mb(length)) != nullptr) {
+            mapping.bytes = length;
+            bool advised = transparent_huge_pages_enabled() && madvise(mapping.base, length, MADV_HUGEPAGE) == 0;
+            mapping.granted = advised ? "2MB THP" : "4KB (THP disabled)";
+        }
+    }
+    if (mapping.base == nullptr) {
+        void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            return false;
+        mapping.base = ptr;
+        mapping.bytes = bytes;
+        mapping.granted = (page_size == PageSize::DEFAULT) ? "4KB" : "4KB (too small for huge pages)";
+    }
+
+    if (interleave) {
+        vector<int> nodes = get_online_nodes();
+        unsigned long mask[16] = {0};
+        for (int node : nodes)
+            if (node < (int)(8 * sizeof(mask)))
+                mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        bool bound = syscall(SYS_mbind, mapping.base, mapping.bytes, MPOL_INTERLEAVE,
+                             mask, (unsigned long)(8 * sizeof(mask)), 0) == 0;
+        mapping.granted += bound ? ", interleaved over " + to_string(nodes.size()) + " node(s)"
+                                 : ", not interleaved";
+    }
+    return true;
+}
+
+void unmap_with_policy(PolicyMapping &mapping) {
+    if (mapping.base != nullptr)
+        munmap(mapping.base, mapping.bytes);
+    mapping = PolicyMapping();
+}
+
+//
+// @brief: Ask for transparent huge pages on the 2MB-aligned part of memory
+// that was not mapped by map_with_policy (e.g. the UPC++ shared segment)
+//
+string advise_huge_pages(void *ptr, size_t bytes) {
+    uintptr_t first = ((uintptr_t)ptr + PAGE_2MB - 1) & ~(uintptr_t)(PAGE_2MB - 1);
+    uintptr_t last = ((uintptr_t)ptr + bytes) & ~(uintptr_t)(PAGE_2MB - 1);
+    if (last <= first)
+        return "4KB (too small for huge pages)";
+    if (transparent_huge_pages_enabled() == false)
+        return "4KB (THP disabled)";
+    return (madvise((void *)first, last - first, MADV_HUGEPAGE) == 0) ? "2MB THP (advised)" : "4KB (advice refused)";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TLB miss counter
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TlbMissCounter::~TlbMissCounter() {
+    if (this->fd >= 0)
+        close(this->fd);
+}
+
+//
+// @brief: Reset and start counting; the threads created from now on are
+// counted too, and their counts are added when they exit
+//
+bool TlbMissCounter::start() {
+    if (this->fd < 0) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        this->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (this->fd < 0)
+            return false;
+    }
+    ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+    return true;
+}
+
+long long int TlbMissCounter::stop() {
+    long long int count = -1;
+    if (this->fd < 0)
+        return -1;
+    ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(this->fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+        return -1;
+    return count;
+}
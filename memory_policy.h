@@ -0,0 +1,129 @@
+//
+// @file    : memory_policy.h
+// @purpose : A definition for the page-size and NUMA placement policies of the factor and rating storage
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MEMORY_POLICY_H_
+#define MEMORY_POLICY_H_
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cassert>
+#include <utility>
+using namespace std;
+
+//
+// @brief: Page size of a mapping:
+//  + DEFAULT:  base pages (4KB)
+//  + HUGE_2MB: 2MB pages, from the hugetlb pool or else transparent huge pages
+//  + HUGE_1GB: 1GB pages from the hugetlb pool, or else as HUGE_2MB
+//
+enum class PageSize { DEFAULT, HUGE_2MB, HUGE_1GB };
+
+//
+// @brief: NUMA placement of the factors:
+//  + DEFAULT:     pages land wherever they are first written, threads float
+//  + FIRST_TOUCH: threads are pinned and every row is first written by its owner
+//  + INTERLEAVE:  as FIRST_TOUCH, but the pages of H (read by every thread
+//                 in turn) are spread round-robin over the NUMA nodes
+//
+enum class NumaPlacement { DEFAULT, FIRST_TOUCH, INTERLEAVE };
+
+struct MemoryPolicy {
+    PageSize                                        page_size       { PageSize::DEFAULT };
+    NumaPlacement                                   numa            { NumaPlacement::DEFAULT };
+};
+
+bool            parse_memory_policy(const string &pages, const string &numa, MemoryPolicy &policy);
+MemoryPolicy    memory_policy_from_env();       // NOMAD_PAGES=4k|2m|1g, NOMAD_NUMA=default|first-touch|interleave
+string          memory_policy_name(const MemoryPolicy &policy);
+int             get_num_numa_nodes();
+bool            pin_thread_to_cpu(int thread_id);
+string          advise_huge_pages(void *ptr, size_t bytes);
+
+//
+// @brief: An anonymous mapping obtained under a policy, and what the kernel
+// actually granted (e.g. "2MB THP" when no 2MB hugetlb page was reserved)
+//
+struct PolicyMapping {
+    void*                                           base            { nullptr };
+    size_t                                          bytes           { 0 };
+    string                                          granted         { "none" };
+};
+
+bool            map_with_policy(size_t bytes, PageSize page_size, bool interleave, PolicyMapping &mapping);
+void            unmap_with_policy(PolicyMapping &mapping);
+
+//
+// @brief: A fixed-size array of T in a policy mapping. The pages are zero
+// and not backed until first written, so the thread that writes an element
+// first decides where its page lives
+//
+template <typename T>
+class PolicyArray {
+
+public:
+    PolicyArray()                           = default;
+    PolicyArray(size_t size, PageSize page_size, bool interleave) : size_ {size} {
+        bool mapped = map_with_policy(size * sizeof(T), page_size, interleave, this->mapping);
+        assert(mapped);
+        (void)mapped;
+    }
+
+    PolicyArray(const PolicyArray& old)     = delete;
+    PolicyArray& operator=(const PolicyArray& old) = delete;
+    PolicyArray(PolicyArray&& old) noexcept { *this = std::move(old); }
+    PolicyArray& operator=(PolicyArray&& old) noexcept {
+        if (this != &old) {
+            unmap_with_policy(this->mapping);
+            this->mapping = old.mapping;
+            this->size_ = old.size_;
+            old.mapping = PolicyMapping();
+            old.size_ = 0;
+        }
+        return *this;
+    }
+    ~PolicyArray() { unmap_with_policy(this->mapping); }
+
+    T*                      data() { return (T*)this->mapping.base; }
+    const T*                data() const { return (const T*)this->mapping.base; }
+    size_t                  size() const { return this->size_; }
+    T&                      operator[](size_t idx) { return ((T*)this->mapping.base)[idx]; }
+    const T&                operator[](size_t idx) const { return ((const T*)this->mapping.base)[idx]; }
+    const string&           get_granted() const { return this->mapping.granted; }
+
+private:
+    PolicyMapping                                   mapping;
+    size_t                                          size_           { 0 };
+};
+
+//
+// @brief: Data-TLB load misses of this process and of the threads it
+// creates after start() (perf_event_open); not available when the kernel
+// forbids it, e.g. under perf_event_paranoid > 2 or in a container
+//
+class TlbMissCounter {
+
+public:
+    TlbMissCounter()                        = default;
+    TlbMissCounter(const TlbMissCounter& old) = delete;
+    TlbMissCounter& operator=(const TlbMissCounter& old) = delete;
+    ~TlbMissCounter();
+
+    bool                    start();
+    long long int           stop();         // -1 if not available
+
+private:
+    int                                             fd              { -1 };
+};
+
+#endif // MEMORY_POLICY_H_
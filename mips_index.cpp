@@ -0,0 +1,284 @@
+//
+// @file    : mips_index.cpp
+// @purpose : A implementation class for the maximum-inner-product-search index over the rows of H
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "mips_index.h"
+#include <queue>
+#include <functional>
+#include <limits>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Exact scoring
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Inner product of two rows of K doubles
+//
+static double dot_product(const double *a, const double *b, int K) {
+    double dot = 0.0;
+    for (int k = 0; k < K; k++)
+        dot += a[k] * b[k];
+    return dot;
+}
+
+//
+// @brief: Keep the N best (item, score) pairs, sorted by decreasing score
+//
+static void keep_top_n(vector<pair<int, double>> &scored, int N) {
+    auto better = [](const pair<int, double> &a, const pair<int, double> &b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    };
+    N = min(N, (int)scored.size());
+    partial_sort(scored.begin(), scored.begin() + N, scored.end(), better);
+    scored.resize(N);
+}
+
+vector<pair<int, double>> exact_top_n(const double *H, int num_items, int K,
+                                      const double *query, int N, int exclude_item) {
+    vector<pair<int, double>> scored;
+    scored.reserve(num_items);
+    for (int j = 0; j < num_items; j++) {
+        if (j != exclude_item)
+            scored.push_back(make_pair(j, dot_product(query, H + (size_t)j * K, K)));
+    }
+    keep_top_n(scored, N);
+    return scored;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Default operations
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HnswIndex::HnswIndex(const double *H, int num_items, int K,
+                     int M, int ef_construction, unsigned random_seed)
+    : H                 {H},
+      num_items         {num_items},
+      num_embeddings    {K},
+      dim               {K + 1},
+      M                 {M},
+      M0                {2 * M},
+      ef_construction   {ef_construction},
+      level_mult        {1.0 / log((double)max(2, M))},
+      data              ((size_t)num_items * (K + 1)),
+      level             (num_items, 0),
+      links             (num_items),
+      random_engine     (random_seed) {
+
+    assert(num_items > 0 && K > 0 && M > 1);
+
+    // Augment the rows so that L2 neighbors are inner-product neighbors
+    double max_norm2 = 0.0;
+    for (int j = 0; j < num_items; j++)
+        max_norm2 = max(max_norm2, dot_product(H + (size_t)j * K, H + (size_t)j * K, K));
+    for (int j = 0; j < num_items; j++) {
+        const double *h_j = H + (size_t)j * K;
+        float *x_j = &this->data[(size_t)j * this->dim];
+        for (int k = 0; k < K; k++)
+            x_j[k] = (float)h_j[k];
+        x_j[K] = (float)sqrt(max(0.0, max_norm2 - dot_product(h_j, h_j, K)));
+    }
+
+    for (int j = 0; j < num_items; j++)
+        this->insert(j);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Search functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Approximate top-N items by inner product with 'query', sorted by
+// decreasing exact score; 'exclude_item' (or -1) is skipped
+//
+vector<pair<int, double>> HnswIndex::search(const double *query, int N, int ef_search, int exclude_item) const {
+    vector<float> q(this->dim, 0.0f);
+    for (int k = 0; k < this->num_embeddings; k++)
+        q[k] = (float)query[k];
+
+    // Greedy descent through the upper levels, then a beam search on level 0
+    vector<int> entry = {this->entry_point};
+    for (int l = this->max_level; l > 0; l--)
+        entry = {this->search_layer(q.data(), entry, 1, l)[0].second};
+    vector<pair<float, int>> candidates =
+        this->search_layer(q.data(), entry, max(ef_search, N + (exclude_item >= 0)), 0);
+
+    vector<pair<int, double>> scored;
+    scored.reserve(candidates.size());
+    for (auto &candidate : candidates) {
+        int j = candidate.second;
+        if (j != exclude_item)
+            scored.push_back(make_pair(j, dot_product(query, this->H + (size_t)j * this->num_embeddings,
+                                                      this->num_embeddings)));
+    }
+    keep_top_n(scored, N);
+    return scored;
+}
+
+//
+// @brief: Number of directed links of the graph
+//
+long long int HnswIndex::get_num_links() const {
+    long long int total = 0;
+    for (auto &node_links : this->links)
+        for (auto &level_links : node_links)
+            total += level_links.size();
+    return total;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Private graph functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Squared L2 distance of two augmented rows
+//
+float HnswIndex::distance(const float *a, const float *b) const {
+    // Independent partial sums, so that the compiler can vectorize the loop
+    float partial[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    int k = 0;
+    for (; k + 8 <= this->dim; k += 8) {
+        for (int p = 0; p < 8; p++) {
+            float d = a[k + p] - b[k + p];
+            partial[p] += d * d;
+        }
+    }
+    float dist = 0.0f;
+    for (; k < this->dim; k++)
+        dist += (a[k] - b[k]) * (a[k] - b[k]);
+    for (int p = 0; p < 8; p++)
+        dist += partial[p];
+    return dist;
+}
+
+//
+// @brief: Beam search of width 'ef' on one level; returns the (distance,
+// node) pairs found, nearest first
+//
+vector<pair<float, int>> HnswIndex::search_layer(const float *query, const vector<int> &entry_points,
+                                                 int ef, int level) const {
+    // Visited marks are reused across the searches of a thread
+    thread_local vector<unsigned> visited_tag;
+    thread_local unsigned visited_epoch = 0;
+    if ((int)visited_tag.size() < this->num_items)
+        visited_tag.assign(this->num_items, 0);
+    if (++visited_epoch == 0) {
+        fill(visited_tag.begin(), visited_tag.end(), 0);
+        visited_epoch = 1;
+    }
+
+    priority_queue<pair<float, int>, vector<pair<float, int>>, greater<pair<float, int>>> frontier;
+    priority_queue<pair<float, int>> nearest;      // the farthest of the ef nearest on top
+    for (int node : entry_points) {
+        float dist = this->distance(query, this->vector_of(node));
+        visited_tag[node] = visited_epoch;
+        frontier.push(make_pair(dist, node));
+        nearest.push(make_pair(dist, node));
+    }
+
+    while (frontier.empty() == false) {
+        pair<float, int> current = frontier.top();
+        if (current.first > nearest.top().first && (int)nearest.size() >= ef)
+            break;
+        frontier.pop();
+
+        for (int neighbor : this->links[current.second][level]) {
+            if (visited_tag[neighbor] == visited_epoch)
+                continue;
+            visited_tag[neighbor] = visited_epoch;
+
+            float dist = this->distance(query, this->vector_of(neighbor));
+            if ((int)nearest.size() < ef || dist < nearest.top().first) {
+                frontier.push(make_pair(dist, neighbor));
+                nearest.push(make_pair(dist, neighbor));
+                if ((int)nearest.size() > ef)
+                    nearest.pop();
+            }
+        }
+    }
+
+    vector<pair<float, int>> result(nearest.size());
+    for (int p = (int)result.size() - 1; p >= 0; p--) {
+        result[p] = nearest.top();
+        nearest.pop();
+    }
+    return result;
+}
+
+//
+// @brief: Neighbor selection heuristic: a candidate (nearest first) is kept
+// unless it is closer to an already kept neighbor than to the base node,
+// which keeps links towards several directions
+//
+vector<int> HnswIndex::select_neighbors(const vector<pair<float, int>> &candidates, int max_links) const {
+    vector<int> selected;
+    for (auto &candidate : candidates) {
+        if ((int)selected.size() >= max_links)
+            break;
+        bool keep = true;
+        for (int other : selected) {
+            if (this->distance(this->vector_of(candidate.second), this->vector_of(other)) < candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep)
+            selected.push_back(candidate.second);
+    }
+    return selected;
+}
+
+//
+// @brief: Insert a node: draw its top level, descend greedily to it, then
+// link it on every level below with the selected neighbors, pruning the
+// links of the neighbors that become too many
+//
+void HnswIndex::insert(int node) {
+    std::uniform_real_distribution<double> uniform(numeric_limits<double>::min(), 1.0);
+    int node_level = (int)(-log(uniform(this->random_engine)) * this->level_mult);
+    this->level[node] = node_level;
+    this->links[node].assign(node_level + 1, vector<int>());
+
+    if (this->entry_point < 0) {
+        this->entry_point = node;
+        this->max_level = node_level;
+        return;
+    }
+
+    const float *q = this->vector_of(node);
+    vector<int> entry = {this->entry_point};
+    for (int l = this->max_level; l > node_level; l--)
+        entry = {this->search_layer(q, entry, 1, l)[0].second};
+
+    for (int l = min(node_level, this->max_level); l >= 0; l--) {
+        vector<pair<float, int>> candidates = this->search_layer(q, entry, this->ef_construction, l);
+        int max_links = (l == 0) ? this->M0 : this->M;
+        this->links[node][l] = this->select_neighbors(candidates, this->M);
+
+        for (int neighbor : this->links[node][l]) {
+            vector<int> &back = this->links[neighbor][l];
+            back.push_back(node);
+            if ((int)back.size() <= max_links)
+                continue;
+
+            vector<pair<float, int>> ranked;
+            for (int other : back)
+                ranked.push_back(make_pair(this->distance(this->vector_of(neighbor), this->vector_of(other)), other));
+            sort(ranked.begin(), ranked.end());
+            back = this->select_neighbors(ranked, max_links);
+        }
+
+        entry.clear();
+        for (auto &candidate : candidates)
+            entry.push_back(candidate.second);
+    }
+
+    if (node_level > this->max_level) {
+        this->max_level = node_level;
+        this->entry_point = node;
+    }
+}
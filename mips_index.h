@@ -0,0 +1,78 @@
+//
+// @file    : mips_index.h
+// @purpose : A definition class for the maximum-inner-product-search index over the rows of H
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MIPS_INDEX_H_
+#define MIPS_INDEX_H_
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <random>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+using namespace std;
+
+//
+// @brief: Exact top-N items by inner product with 'query' (brute force),
+// sorted by decreasing score; 'exclude_item' (or -1) is skipped
+//
+vector<pair<int, double>>   exact_top_n(const double *H, int num_items, int K,
+                                        const double *query, int N, int exclude_item);
+
+//
+// @brief: HNSW graph (Malkov & Yashunin) over the rows of H for maximum inner
+// product search. Every row h_j is augmented to [h_j, sqrt(R^2 - |h_j|^2)]
+// with R the largest norm, and a query q to [q, 0]: the nearest rows in L2
+// are then the rows with the largest inner product. The graph holds float
+// copies of the augmented rows; the candidates are rescored exactly on H
+//
+class HnswIndex {
+
+public:
+    HnswIndex()                             = default;
+    HnswIndex(const double *H, int num_items, int K,        // Build the graph
+              int M, int ef_construction, unsigned random_seed);
+
+    HnswIndex(const HnswIndex& old)         = default;
+    HnswIndex& operator=(const HnswIndex& old) = default;
+
+    vector<pair<int, double>>   search(const double *query, int N, int ef_search, int exclude_item) const;
+    int                     get_max_level() const { return this->max_level; }
+    long long int           get_num_links() const;
+
+private:
+    float                   distance(const float *a, const float *b) const;
+    const float*            vector_of(int node) const { return &this->data[(size_t)node * this->dim]; }
+    vector<pair<float, int>> search_layer(const float *query, const vector<int> &entry_points,
+                                         int ef, int level) const;
+    vector<int>             select_neighbors(const vector<pair<float, int>> &candidates, int max_links) const;
+    void                    insert(int node);
+
+    const double*                                   H               { nullptr };
+    int                                             num_items       { 0 };
+    int                                             num_embeddings  { 0 };
+    int                                             dim             { 0 };      // num_embeddings + 1
+    int                                             M               { 16 };     // links per node above level 0
+    int                                             M0              { 32 };     // links per node on level 0
+    int                                             ef_construction { 200 };
+    double                                          level_mult      { 0.0 };
+    int                                             entry_point     { -1 };
+    int                                             max_level       { -1 };
+    vector<float>                                   data;           // augmented rows
+    vector<int>                                     level;          // top level of each node
+    vector<vector<vector<int>>>                     links;          // links[node][level]
+    std::default_random_engine                      random_engine;
+};
+
+#endif // MIPS_INDEX_H_
@@ -0,0 +1,130 @@
+//
+// @file    : model_store.cpp
+// @purpose : A implementation class for the memory-mapped factors of a trained model
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "model_store.h"
+#include "data_io.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MODEL_MAGIC[8] = {'N', 'O', 'M', 'A', 'D', 'F', 'A', 'C'};
+static const size_t MODEL_HEADER_BYTES = 24;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Default operations
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MappedModel::~MappedModel() {
+    this->close();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Model functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Map a binary model file read-only
+//
+bool MappedModel::open(const string &file_binary) {
+    this->close();
+
+    int fd = ::open(file_binary.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < MODEL_HEADER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    // Check the header and the size of the factors
+    const char *bytes = (const char *)mapping;
+    int32_t header[3];
+    memcpy(header, bytes + 8, sizeof(header));
+    size_t expected = MODEL_HEADER_BYTES + ((size_t)header[0] + header[1]) * header[2] * sizeof(double);
+    if (memcmp(bytes, MODEL_MAGIC, 8) != 0 || header[0] <= 0 || header[1] <= 0 || header[2] <= 0 ||
+        expected != (size_t)st.st_size) {
+        munmap(mapping, st.st_size);
+        return false;
+    }
+
+    this->mapping = mapping;
+    this->mapping_size = st.st_size;
+    this->num_users = header[0];
+    this->num_items = header[1];
+    this->num_embeddings = header[2];
+    this->W = (const double *)(bytes + MODEL_HEADER_BYTES);
+    this->H = this->W + (size_t)this->num_users * this->num_embeddings;
+    return true;
+}
+
+//
+// @brief: Convert the text model written by NOMAD-UPC into a binary model
+//
+bool MappedModel::convert(const string &file_text, const string &file_binary) {
+    int NROW, NCOL, K;
+    vector<double> W, H;
+    if (read_model(file_text, NROW, NCOL, K, W, H) == false)
+        return false;
+
+    FILE *out = fopen(file_binary.c_str(), "wb");
+    if (out == nullptr)
+        return false;
+    int32_t header[4] = {NROW, NCOL, K, 0};
+    bool ok = fwrite(MODEL_MAGIC, 1, 8, out) == 8 &&
+              fwrite(header, sizeof(int32_t), 4, out) == 4 &&
+              fwrite(W.data(), sizeof(double), W.size(), out) == W.size() &&
+              fwrite(H.data(), sizeof(double), H.size(), out) == H.size();
+    ok = (fclose(out) == 0) && ok;
+    return ok;
+}
+
+//
+// @brief: Map "[file_text].bin", (re)building it first when it is missing or
+// older than the text model. A binary model can also be given directly
+//
+bool MappedModel::open_or_convert(MappedModel &model, const string &file_text) {
+    if (model.open(file_text))
+        return true;
+
+    const string file_binary = file_text + ".bin";
+    struct stat st_text, st_binary;
+    bool have_text = (stat(file_text.c_str(), &st_text) == 0);
+    bool have_binary = (stat(file_binary.c_str(), &st_binary) == 0);
+
+    if (have_text && (have_binary == false || st_binary.st_mtime < st_text.st_mtime)) {
+        if (MappedModel::convert(file_text, file_binary) == false)
+            return false;
+    }
+    return model.open(file_binary);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Private functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Unmap the current model, if any
+//
+void MappedModel::close() {
+    if (this->mapping != nullptr)
+        munmap(this->mapping, this->mapping_size);
+    this->mapping = nullptr;
+    this->mapping_size = 0;
+    this->W = nullptr;
+    this->H = nullptr;
+    this->num_users = this->num_items = this->num_embeddings = 0;
+}
@@ -0,0 +1,60 @@
+//
+// @file    : model_store.h
+// @purpose : A definition class for the memory-mapped factors of a trained model
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MODEL_STORE_H_
+#define MODEL_STORE_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+//
+// @brief: Read-only view of W and H mapped from a binary model file:
+// a 24-byte header ("NOMADFAC", NROW, NCOL, K as int32, 4 bytes of padding)
+// followed by the NROW x K doubles of W and the NCOL x K doubles of H.
+// The binary file is derived from the text model written by NOMAD-UPC
+//
+class MappedModel {
+
+public:
+    MappedModel()                           = default;
+    MappedModel(const MappedModel& old)     = delete;
+    MappedModel& operator=(const MappedModel& old) = delete;
+    ~MappedModel();
+
+    bool                    open(const string &file_binary);
+    static bool             convert(const string &file_text, const string &file_binary);
+    static bool             open_or_convert(MappedModel &model, const string &file_text);
+
+    int                     get_num_users() const { return this->num_users; }
+    int                     get_num_items() const { return this->num_items; }
+    int                     get_num_embeddings() const { return this->num_embeddings; }
+    const double*           W_row(int user_idx) const { return this->W + (size_t)user_idx * this->num_embeddings; }
+    const double*           H_row(int item_idx) const { return this->H + (size_t)item_idx * this->num_embeddings; }
+    const double*           H_data() const { return this->H; }
+
+private:
+    void                    close();
+
+    int                                             num_users       { 0 };
+    int                                             num_items       { 0 };
+    int                                             num_embeddings  { 0 };
+    void*                                           mapping         { nullptr };
+    size_t                                          mapping_size    { 0 };
+    const double*                                   W               { nullptr };
+    const double*                                   H               { nullptr };
+};
+
+#endif // MODEL_STORE_H_
@@ -0,0 +1,119 @@
+//
+// @file    : regression.cpp
+// @purpose : A implementation for the run records of the performance regression harness
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "regression.h"
+#include "rng.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+//
+// @brief: Order-dependent hash of the bits of every value of W then H
+//
+uint64_t factor_checksum(const vector<double> &W, const vector<double> &H) {
+    uint64_t hash = splitmix64(W.size() * 31 + H.size());
+    for (const vector<double> *factors : {&W, &H}) {
+        for (double value : *factors) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = splitmix64(hash ^ bits);
+        }
+    }
+    return hash;
+}
+
+//
+// @brief: Write a run record as "key value" lines
+//
+bool write_run_record(const string file_output, const RunRecord &run) {
+    ofstream export_file(file_output, ios::out);
+    if (export_file.is_open() == false)
+        return false;
+    export_file.precision(numeric_limits<double>::max_digits10);
+    export_file << "input " << run.input << endl
+                << "solver " << run.solver << endl
+                << "routing " << run.routing << endl
+                << "codec " << run.codec << endl
+                << "init " << run.init << endl
+                << "hot_factor " << run.hot_factor << endl
+                << "num_proc " << run.num_proc << endl
+                << "num_epochs " << run.num_epochs << endl
+                << "num_embeddings " << run.num_embeddings << endl
+                << "reproducible " << run.reproducible << endl
+                << "seed " << run.seed << endl
+                << "train_time " << run.train_time << endl
+                << "train_rmse " << run.train_rmse << endl
+                << "checksum " << run.checksum << endl;
+    return export_file.good();
+}
+
+bool read_run_record(const string file_input, RunRecord &run) {
+    ifstream import_file(file_input, ios::in);
+    if (import_file.is_open() == false)
+        return false;
+    string key;
+    while (import_file >> key) {
+        if (key == "input")                 getline(import_file >> ws, run.input);
+        else if (key == "solver")           import_file >> run.solver;
+        else if (key == "routing")          import_file >> run.routing;
+        else if (key == "codec")            import_file >> run.codec;
+        else if (key == "init")             import_file >> run.init;
+        else if (key == "hot_factor")       import_file >> run.hot_factor;
+        else if (key == "num_proc")         import_file >> run.num_proc;
+        else if (key == "num_epochs")       import_file >> run.num_epochs;
+        else if (key == "num_embeddings")   import_file >> run.num_embeddings;
+        else if (key == "reproducible")     import_file >> run.reproducible;
+        else if (key == "seed")             import_file >> run.seed;
+        else if (key == "train_time")       import_file >> run.train_time;
+        else if (key == "train_rmse")       import_file >> run.train_rmse;
+        else if (key == "checksum")         import_file >> run.checksum;
+        else                                return false;
+    }
+    return import_file.eof();
+}
+
+//
+// @brief: Print how a run compares with its baseline; it passes when both
+// ran the same configuration, the factors are bit-identical (reproducible
+// runs) or the train RMSE is within 1% (other runs), and the training time
+// is at most (1 + time_tolerance) times the baseline
+//
+bool compare_with_baseline(const RunRecord &run, const RunRecord &baseline, double time_tolerance) {
+    if (run.input != baseline.input || run.solver != baseline.solver || run.routing != baseline.routing ||
+        run.codec != baseline.codec || run.init != baseline.init || run.hot_factor != baseline.hot_factor ||
+        run.num_proc != baseline.num_proc || run.num_epochs != baseline.num_epochs ||
+        run.num_embeddings != baseline.num_embeddings || run.reproducible != baseline.reproducible ||
+        run.seed != baseline.seed) {
+        printf(">\tRegression: FAIL, the baseline ran another configuration (%s, %s, routing=%s, codec=%s, init=%s, "
+               "hot factor %g, %d procs, %lld epochs, K=%d, seed=%llu)\n",
+               baseline.input.c_str(), baseline.solver.c_str(), baseline.routing.c_str(), baseline.codec.c_str(),
+               baseline.init.c_str(), baseline.hot_factor, baseline.num_proc, baseline.num_epochs,
+               baseline.num_embeddings, (unsigned long long)baseline.seed);
+        return false;
+    }
+
+    bool same_model = run.reproducible ? (run.checksum == baseline.checksum)
+                                       : (fabs(run.train_rmse - baseline.train_rmse) <= 0.01 * baseline.train_rmse);
+    bool fast_enough = run.train_time <= (1.0 + time_tolerance) * baseline.train_time;
+    printf(">\tRegression: train RMSE %.6f vs %.6f, factors %s, time %.3fs vs %.3fs (%+.1f%%, tolerance %.0f%%)\n",
+           run.train_rmse, baseline.train_rmse,
+           run.reproducible ? (same_model ? "bit-identical" : "DIFFERENT") : (same_model ? "close" : "DIFFERENT"),
+           run.train_time, baseline.train_time,
+           100.0 * (run.train_time / max(baseline.train_time, 1e-9) - 1.0), 100.0 * time_tolerance);
+    printf(">\tRegression: %s\n", (same_model && fast_enough) ? "PASS" :
+                                  (same_model ? "FAIL (slower)" : "FAIL (model changed)"));
+    return same_model && fast_enough;
+}
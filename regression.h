@@ -0,0 +1,49 @@
+//
+// @file    : regression.h
+// @purpose : A definition for the run records of the performance regression harness
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef REGRESSION_H_
+#define REGRESSION_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+//
+// @brief: What a run did and what it gave; reproducible runs (seed given)
+// of the same configuration must give the same factor checksum
+//
+struct RunRecord {
+    string                                          input;          // file_input (or the delta of incremental runs)
+    string                                          solver;
+    string                                          routing;
+    string                                          codec;
+    string                                          init;
+    double                                          hot_factor      { 0.0 };
+    int                                             num_proc        { 0 };
+    long long int                                   num_epochs      { 0 };
+    int                                             num_embeddings  { 0 };
+    bool                                            reproducible    { false };
+    uint64_t                                        seed            { 0 };
+    double                                          train_time      { 0.0 };
+    double                                          train_rmse      { 0.0 };
+    uint64_t                                        checksum        { 0 };      // of the bits of W and H
+};
+
+uint64_t    factor_checksum(const vector<double> &W, const vector<double> &H);
+bool        write_run_record(const string file_output, const RunRecord &run);
+bool        read_run_record(const string file_input, RunRecord &run);
+bool        compare_with_baseline(const RunRecord &run, const RunRecord &baseline, double time_tolerance);
+
+#endif // REGRESSION_H_
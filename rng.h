@@ -0,0 +1,65 @@
+//
+// @file    : rng.h
+// @purpose : Counter-based random numbers, reproducible for any number of processes
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RNG_H_
+#define RNG_H_
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+//
+// @brief: Independent streams of counter-based random numbers: the value of
+// (seed, stream, counter) does not depend on who computes it or in which order
+//
+enum RngStream : uint64_t {
+    RNG_STREAM_W        = 1,    // counter = user_idx * K + k
+    RNG_STREAM_H        = 2,    // counter = item_idx * K + k
+    RNG_STREAM_SKETCH   = 3,    // counter = item_idx * l + c (randomized SVD)
+    RNG_STREAM_RANK     = 4     // counter = proc_id (per-process seeds of reproducible runs)
+};
+
+//
+// @brief: SplitMix64 finalizer, a bijective 64-bit mixing function
+//
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+//
+// @brief: 64 random bits for (seed, stream, counter)
+//
+inline uint64_t counter_hash(uint64_t seed, uint64_t stream, uint64_t counter) {
+    return splitmix64(seed ^ splitmix64(stream ^ splitmix64(counter)));
+}
+
+//
+// @brief: Uniform double in [0, 1) for (seed, stream, counter)
+//
+inline double counter_uniform(uint64_t seed, uint64_t stream, uint64_t counter) {
+    return (double)(counter_hash(seed, stream, counter) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//
+// @brief: Standard normal double for (seed, stream, counter) (Box-Muller)
+//
+inline double counter_normal(uint64_t seed, uint64_t stream, uint64_t counter) {
+    double u1 = counter_uniform(seed, stream, 2 * counter);
+    double u2 = counter_uniform(seed, stream, 2 * counter + 1);
+    return sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+}
+
+#endif // RNG_H_
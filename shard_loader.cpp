@@ -0,0 +1,400 @@
+//
+// @file    : shard_loader.cpp
+// @purpose : A implementation class for the parallel loader streaming rating shards to their owners
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "shard_loader.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Line parsing
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+//
+// @brief: The first line start at or after pos in [first, size]
+//
+static size_t next_line_start(const char *data, size_t first, size_t size, size_t pos) {
+    if (pos <= first)
+        return first;
+    while (pos < size && data[pos - 1] != '\n')
+        pos++;
+    return min(pos, size);
+}
+
+//
+// @brief: Call on_line(begin, end) for every non-blank line of [begin, end)
+//
+template <typename F>
+static void for_each_line(const char *data, size_t begin, size_t end, F on_line) {
+    size_t p = begin;
+    while (p < end) {
+        size_t q = p;
+        bool blank = true;
+        while (q < end && data[q] != '\n') {
+            blank = blank && is_blank(data[q]);
+            q++;
+        }
+        if (blank == false)
+            on_line(data + p, data + q);
+        p = q + 1;
+    }
+}
+
+//
+// @brief: Parse the values of one row, calling on_value(j, v) for the
+// non-zero ones; returns the number of values, or -1 on a malformed value
+//
+template <typename F>
+static int parse_row(const char *p, const char *end, F on_value) {
+    char token[64];
+    int num_values = 0;
+    while (true) {
+        while (p < end && is_blank(*p))
+            p++;
+        if (p == end)
+            return num_values;
+
+        // The mapping is not null-terminated: strtod works on a copy of the token
+        size_t length = 0;
+        while (p + length < end && is_blank(p[length]) == false)
+            length++;
+        if (length >= sizeof(token))
+            return -1;
+        memcpy(token, p, length);
+        token[length] = '\0';
+        char *parsed;
+        double v = strtod(token, &parsed);
+        if (parsed != token + length)
+            return -1;
+        if (v != 0)
+            on_value(num_values, v);
+        num_values++;
+        p += length;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Default operations
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ShardLoader::ShardLoader()
+    : target            (ShardTarget()),
+      all_sends         (upcxx::make_future()) {
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Load file_input (collective): map the file, count the ratings of
+// the range of this process and split the rows. On return the rows of this
+// process are mapped (still zero) and the second pass is ready: the ratings
+// are parsed and shipped by pump(), chunk by chunk, from the training loop,
+// or all at once by wait(). Every process takes the same branch: the
+// outcome of each step is agreed by a reduction before acting on it
+//
+bool ShardLoader::start(const string &file_input, const MemoryPolicy &policy) {
+    int num_proc = upcxx::rank_n();
+    int rank = upcxx::rank_me();
+    auto count_start = std::chrono::steady_clock::now();
+
+    // 0: cannot be read, 1: read by read_data, 2: streamed
+    int status = 2;
+    const char *data = nullptr;
+    size_t size = 0;
+    int fd = open(file_input.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        status = 0;
+    } else {
+        size = (size_t)info.st_size;
+        data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == (const char*)MAP_FAILED) {
+            data = nullptr;
+            status = 1;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+
+    // Header "NROW NCOL", then the byte range of this process, cut at line starts
+    size_t first = 0;
+    if (data != nullptr) {
+        while (first < size && data[first] != '\n')
+            first++;
+        string header(data, first);
+        first = min(first + 1, size);
+        if (sscanf(header.c_str(), "%d %d", &this->num_rows, &this->num_cols) != 2 ||
+            this->num_rows <= 0 || this->num_cols <= 0)
+            status = 1;
+    }
+    status = upcxx::reduce_all(status, upcxx::op_fast_min).wait();
+    if (status < 2) {
+        if (data != nullptr)
+            munmap((void*)data, size);
+        return (status == 1) ? this->load_sequential(file_input, policy) : false;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+    size_t length = size - first;
+    size_t begin = next_line_start(data, first, size, first + length * rank / num_proc);
+    size_t end = next_line_start(data, first, size, first + length * (rank + 1) / num_proc);
+
+    // First pass: the ratings of every line of the range and of every column
+    vector<int> range_count;
+    this->item_count.assign(this->num_cols, 0);
+    long long int malformed = 0;
+    for_each_line(data, begin, end, [&](const char *p, const char *e) {
+        int count = 0;
+        int num_values = parse_row(p, e, [&](int j, double) {
+            if (j < this->num_cols)
+                this->item_count[j]++;
+            count++;
+        });
+        if (num_values != this->num_cols)
+            malformed++;
+        range_count.push_back(count);
+    });
+
+    // The first row of the range follows the lines of the lower ranges
+    vector<long long int> range_lines(num_proc, 0);
+    range_lines[rank] = range_count.size();
+    upcxx::reduce_all(range_lines.data(), range_lines.data(), num_proc, upcxx::op_fast_add).wait();
+    malformed = upcxx::reduce_all(malformed, upcxx::op_fast_add).wait();
+    long long int total_lines = 0, first_row = 0;
+    for (int r = 0; r < num_proc; r++) {
+        if (r == rank)
+            first_row = total_lines;
+        total_lines += range_lines[r];
+    }
+    if (malformed > 0 || total_lines != this->num_rows) {
+        munmap((void*)data, size);
+        return this->load_sequential(file_input, policy);
+    }
+
+    this->row_count.assign(this->num_rows, 0);
+    copy(range_count.begin(), range_count.end(), this->row_count.begin() + first_row);
+    upcxx::reduce_all(this->row_count.data(), this->row_count.data(), this->num_rows, upcxx::op_fast_add).wait();
+    upcxx::reduce_all(this->item_count.data(), this->item_count.data(), this->num_cols, upcxx::op_fast_add).wait();
+    this->own_rows(policy);
+    this->streamed = true;
+
+    // Second pass state: the outboxes hold at most max(4 MB, 4 KB per process)
+    // of ratings in all (16 bytes each), whatever the number of processes
+    this->mapping = data;
+    this->mapping_size = size;
+    this->cursor = begin;
+    this->range_end = end;
+    this->next_row = first_row;
+    this->released = (begin / (size_t)sysconf(_SC_PAGESIZE)) * (size_t)sysconf(_SC_PAGESIZE);
+    this->chunk_size = max(256, (1 << 18) / num_proc);
+    this->outbox.assign(num_proc, vector<Rating>());
+    this->count_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - count_start).count();
+
+    // Every process has mapped its rows before any rating is sent
+    upcxx::barrier();
+    return true;
+}
+
+//
+// @brief: Second pass over about 'max_bytes' more of the range (not
+// collective): parse the rows and stream every rating to the owner of its
+// row; the pages of the file are released once parsed. Returns whether the
+// range is done, the last chunks sent and the file unmapped
+//
+bool ShardLoader::pump(size_t max_bytes) {
+    if (this->mapping == nullptr)
+        return true;
+    auto pump_start = std::chrono::steady_clock::now();
+    int rank = upcxx::rank_me();
+    const char *data = this->mapping;
+    size_t stop = min(this->range_end, next_line_start(data, this->cursor, this->mapping_size,
+                                                       this->cursor + max_bytes));
+    for_each_line(data, this->cursor, stop, [&](const char *p, const char *e) {
+        int receiver_id = this->owner[this->next_row];
+        int local_row = this->owner_row[this->next_row];
+        if (receiver_id == rank) {
+            double *A_i = this->target->A + (size_t)local_row * this->num_cols;
+            parse_row(p, e, [&](int j, double v) { A_i[j] = v; });
+            this->target->num_received += this->row_count[this->next_row];
+        } else {
+            vector<Rating> &chunk = this->outbox[receiver_id];
+            parse_row(p, e, [&](int j, double v) { chunk.push_back(Rating{local_row, j, v}); });
+            if (chunk.size() >= this->chunk_size)
+                this->ship(receiver_id, chunk);
+        }
+        this->next_row++;
+    });
+    this->cursor = stop;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t parsed = (stop / page) * page;
+    if (parsed >= this->released + ((size_t)32 << 20) || stop == this->range_end) {
+        madvise((void*)(data + this->released), parsed - this->released, MADV_DONTNEED);
+        this->released = parsed;
+    }
+
+    if (stop == this->range_end) {
+        for (int r = 0; r < (int)this->outbox.size(); r++) {
+            if (this->outbox[r].empty() == false)
+                this->ship(r, this->outbox[r]);
+        }
+        this->outbox.clear();
+        munmap((void*)this->mapping, this->mapping_size);
+        this->mapping = nullptr;
+    }
+    this->ship_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - pump_start).count();
+    return this->mapping == nullptr;
+}
+
+//
+// @brief: Every process reads the whole file and keeps its rows (files
+// whose rows are not one per line)
+//
+bool ShardLoader::load_sequential(const string &file_input, const MemoryPolicy &policy) {
+    auto count_start = std::chrono::steady_clock::now();
+    vector<vector<double>> mat_data;
+    read_data(file_input, this->num_rows, this->num_cols, mat_data, this->row_count);
+    int ok = (this->num_rows > 0 && this->num_cols > 0 && (int)mat_data.size() == this->num_rows) ? 1 : 0;
+    if (upcxx::reduce_all(ok, upcxx::op_fast_min).wait() == 0)
+        return false;
+    assert_matrix_size(mat_data, this->num_rows, this->num_cols);
+    this->start(mat_data, this->row_count, policy);
+    this->count_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - count_start).count();
+    return true;
+}
+
+//
+// @brief: Take the rows of this process from a matrix held by every
+// process (incremental training, where the delta is merged first)
+//
+void ShardLoader::start(const vector<vector<double>> &mat_data, const vector<int> &row_count,
+                        const MemoryPolicy &policy) {
+    this->num_rows = mat_data.size();
+    this->num_cols = mat_data[0].size();
+    this->row_count = row_count;
+    this->item_count.assign(this->num_cols, 0);
+    for (auto &row : mat_data)
+        for (int j = 0; j < this->num_cols; j++)
+            if (row[j] != 0)
+                this->item_count[j]++;
+
+    this->own_rows(policy);
+    for (int i = 0; i < (int)this->user_index.size(); i++)
+        copy(mat_data[this->user_index[i]].begin(), mat_data[this->user_index[i]].end(),
+             &this->A[(size_t)i * this->num_cols]);
+    this->target->num_received = this->num_expected;
+    this->streamed = false;
+}
+
+//
+// @brief: Split the rows over the processes (same split on every process)
+// and map the rows of this process with the memory policy
+//
+void ShardLoader::own_rows(const MemoryPolicy &policy) {
+    vector<vector<int>> split_row_index = split_array_index(this->row_count, upcxx::rank_n());
+    this->owner.assign(this->num_rows, -1);
+    this->owner_row.assign(this->num_rows, -1);
+    for (int r = 0; r < (int)split_row_index.size(); r++) {
+        for (int i = 0; i < (int)split_row_index[r].size(); i++) {
+            this->owner[split_row_index[r][i]] = r;
+            this->owner_row[split_row_index[r][i]] = i;
+        }
+    }
+
+    this->user_index = split_row_index[upcxx::rank_me()];
+    this->A = PolicyArray<double>(this->user_index.size() * this->num_cols, policy.page_size, false);
+    this->num_expected = 0;
+    for (int user_idx : this->user_index)
+        this->num_expected += this->row_count[user_idx];
+    this->target->A = this->A.data();
+    this->target->num_cols = this->num_cols;
+}
+
+//
+// @brief: Send a chunk of (local row on the owner, item, value) to its owner
+//
+void ShardLoader::ship(int owner, vector<Rating> &chunk) {
+    this->bytes_shipped += chunk.size() * sizeof(Rating);
+    this->all_sends = upcxx::when_all(this->all_sends,
+        upcxx::rpc(owner,
+                   [](upcxx::dist_object<ShardTarget> &target, const vector<Rating> &chunk) {
+                       for (auto &rating : chunk)
+                           target->A[(size_t)rating.user_idx * target->num_cols + rating.item_idx] = rating.value;
+                       target->num_received += chunk.size();
+                   },
+                   this->target, chunk));
+    chunk.clear();
+
+    // Apply the chunks sent to this process while parsing
+    upcxx::progress();
+}
+
+//
+// @brief: Whether this process has shipped its range and every rating of
+// the local rows has arrived (not collective)
+//
+bool ShardLoader::is_resident() {
+    upcxx::progress();
+    return this->mapping == nullptr && this->target->num_received == this->num_expected &&
+           this->all_sends.ready();
+}
+
+//
+// @brief: Finish the second pass of this process, then wait for the
+// ratings of the local rows and for the chunks it sent (not collective)
+//
+void ShardLoader::wait() {
+    while (this->pump((size_t)64 << 20) == false)
+        ;
+    auto wait_start = std::chrono::steady_clock::now();
+    while (this->target->num_received < this->num_expected)
+        upcxx::progress();
+    this->all_sends.wait();
+    this->wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+}
+
+//
+// @brief: Print the load time of the slowest process, the bytes shipped
+// and the peak RSS of the largest process (collective)
+//
+void ShardLoader::report() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double peak_rss = upcxx::reduce_all(usage.ru_maxrss / 1024.0, upcxx::op_fast_max).wait();
+    double count_time = upcxx::reduce_all(this->count_time, upcxx::op_fast_max).wait();
+    double ship_time = upcxx::reduce_all(this->ship_time, upcxx::op_fast_max).wait();
+    double wait_time = upcxx::reduce_all(this->wait_time, upcxx::op_fast_max).wait();
+    long long int bytes_shipped = upcxx::reduce_all(this->bytes_shipped, upcxx::op_fast_add).wait();
+    long long int num_ratings = 0;
+    for (int count : this->row_count)
+        num_ratings += count;
+
+    if (upcxx::rank_me() == 0) {
+        if (this->streamed)
+            printf(">\tLoad: %d x %d, %lld ratings streamed from %d shards: count %.3fs, parse+ship %.3fs, "
+                   "late arrivals %.3fs, %.1f MB shipped, peak RSS %.1f MB\n",
+                   this->num_rows, this->num_cols, num_ratings, upcxx::rank_n(), count_time, ship_time,
+                   wait_time, bytes_shipped / 1048576.0, peak_rss);
+        else
+            printf(">\tLoad: %d x %d, %lld ratings read whole by every process, peak RSS %.1f MB\n",
+                   this->num_rows, this->num_cols, num_ratings, peak_rss);
+    }
+}
@@ -0,0 +1,109 @@
+//
+// @file    : shard_loader.h
+// @purpose : A definition class for the parallel loader streaming rating shards to their owners
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHARD_LOADER_H_
+#define SHARD_LOADER_H_
+#pragma once
+
+#include <vector>
+#include <string>
+#include <upcxx/upcxx.hpp>
+#include "data_io.h"
+#include "memory_policy.h"
+using namespace std;
+
+//
+// @brief: The local rows of A on their owner, written by the RPCs of the
+// other processes (the mapping does not move when A is moved into a Worker)
+//
+struct ShardTarget {
+    double                                          *A              { nullptr };
+    int                                             num_cols        { 0 };
+    long long int                                   num_received    { 0 };      // ratings written so far
+};
+
+//
+// @brief: Collective loader of a dense rating file ("NROW NCOL", then one
+// row per line). Each process parses the lines of its 1/P byte range of the
+// file, and streams the ratings of every row to the process owning the row
+// in chunks of RPCs, which write them straight into the rows of A of the
+// owner. The user split (split_array_index) needs the count of every row,
+// so a first pass counts the ratings of the range and a reduction gives the
+// counts of the whole matrix. start() returns after the first pass, and
+// the second pass parses and ships the range piece by piece from pump(),
+// called between the updates of training, so that it overlaps the first
+// epochs; wait() finishes it. Neither the matrix nor the ratings of a range
+// are ever held in full. A file whose rows are not one per line is read by
+// every process with read_data, as before
+//
+class ShardLoader {
+
+public:
+    ShardLoader();
+    ShardLoader(const ShardLoader& old)     = delete;
+    ShardLoader& operator=(const ShardLoader& old) = delete;
+    ShardLoader(ShardLoader&& old)          = delete;
+    ShardLoader& operator=(ShardLoader&& old) = delete;
+    ~ShardLoader()                          = default;
+
+    bool                    start(const string &file_input, const MemoryPolicy &policy);
+    void                    start(const vector<vector<double>> &mat_data, const vector<int> &row_count,
+                                  const MemoryPolicy &policy);
+    bool                    pump(size_t max_bytes);
+    bool                    is_resident();
+    void                    wait();
+    void                    report();
+
+    int                     get_num_rows() const { return this->num_rows; }
+    int                     get_num_cols() const { return this->num_cols; }
+    const vector<int>&      get_row_count() const { return this->row_count; }
+    const vector<int>&      get_item_count() const { return this->item_count; }
+    vector<int>&&           take_user_index() { return std::move(this->user_index); }
+    PolicyArray<double>&&   take_A() { return std::move(this->A); }
+
+private:
+    bool                    load_sequential(const string &file_input, const MemoryPolicy &policy);
+    void                    own_rows(const MemoryPolicy &policy);
+    void                    ship(int owner, vector<Rating> &chunk);
+
+    upcxx::dist_object<ShardTarget>                 target;
+    upcxx::future<>                                 all_sends;
+    int                                             num_rows        { 0 };
+    int                                             num_cols        { 0 };
+    vector<int>                                     row_count;      // ratings of every row
+    vector<int>                                     item_count;     // ratings of every column
+    vector<int>                                     owner;          // process of every row
+    vector<int>                                     owner_row;      // position of every row on its owner
+    vector<int>                                     user_index;     // rows of this process
+    PolicyArray<double>                             A;              // their values, [i * num_cols + j]
+    long long int                                   num_expected    { 0 };      // ratings of the local rows
+    bool                                            streamed        { false };
+
+    // Second pass: the mapped file and the position reached in the range
+    const char                                      *mapping        { nullptr };
+    size_t                                          mapping_size    { 0 };
+    size_t                                          cursor          { 0 };
+    size_t                                          range_end       { 0 };
+    size_t                                          released        { 0 };      // pages before it are dropped
+    long long int                                   next_row        { 0 };      // row of the line at cursor
+    size_t                                          chunk_size      { 0 };      // ratings per RPC
+    vector<vector<Rating>>                          outbox;         // chunk being filled for each process
+
+    // Load statistics of this process
+    double                                          count_time      { 0.0 };
+    double                                          ship_time       { 0.0 };
+    double                                          wait_time       { 0.0 };
+    long long int                                   bytes_shipped   { 0 };
+};
+
+#endif // SHARD_LOADER_H_
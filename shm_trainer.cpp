@@ -0,0 +1,379 @@
+//
+// @file    : shm_trainer.cpp
+// @purpose : A implementation class for the single-node shared-memory trainer
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "shm_trainer.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SPSC queue
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Allocate a ring with at least 'capacity' slots (rounded up to a power of 2)
+//
+SpscQueue::SpscQueue(int capacity) {
+    size_t size = 1;
+    while (size < (size_t)capacity)
+        size <<= 1;
+    this->buffer.resize(size);
+    this->mask = size - 1;
+}
+
+//
+// @brief: Append an item index, called only by the producer thread
+//
+bool SpscQueue::push(int item_idx) {
+    size_t t = this->tail.load(memory_order_relaxed);
+    if (t - this->head.load(memory_order_acquire) == this->buffer.size())
+        return false;
+    this->buffer[t & this->mask] = item_idx;
+    this->tail.store(t + 1, memory_order_release);
+    return true;
+}
+
+//
+// @brief: Take the oldest item index, called only by the consumer thread
+//
+bool SpscQueue::pop(int &item_idx) {
+    size_t h = this->head.load(memory_order_relaxed);
+    if (h == this->tail.load(memory_order_acquire))
+        return false;
+    item_idx = this->buffer[h & this->mask];
+    this->head.store(h + 1, memory_order_release);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rating partition
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Split users into 'num_threads' parts with balanced number of
+// ratings, and store the ratings of each thread sorted by item
+//
+shared_ptr<const RatingPartition> partition_ratings(const vector<Rating> &ratings, int num_users,
+                                                    int num_items, int num_threads) {
+    assert(num_threads > 0 && num_threads <= num_users);
+    auto partition = make_shared<RatingPartition>();
+    partition->num_threads = num_threads;
+    partition->num_users = num_users;
+    partition->num_items = num_items;
+    partition->thread_users.assign(num_threads, vector<int>());
+    partition->thread_ratings.assign(num_threads, vector<Rating>());
+    partition->item_ptr.assign(num_threads, vector<int>(num_items + 1, 0));
+
+    vector<int> row_count(num_users, 0);
+    for (auto &rating : ratings)
+        row_count[rating.user_idx]++;
+    vector<vector<int>> split_row_index = split_array_index(row_count, num_threads);
+    vector<int> owner(num_users, 0);
+    for (int t = 0; t < num_threads; t++) {
+        for (int usr_idx : split_row_index[t])
+            owner[usr_idx] = t;
+        partition->thread_users[t] = split_row_index[t];
+    }
+
+    for (auto &rating : ratings)
+        partition->thread_ratings[owner[rating.user_idx]].push_back(rating);
+    for (int t = 0; t < num_threads; t++) {
+        vector<Rating> &local = partition->thread_ratings[t];
+        stable_sort(local.begin(), local.end(),
+                    [](const Rating &a, const Rating &b) { return a.item_idx < b.item_idx; });
+        for (auto &rating : local)
+            partition->item_ptr[t][rating.item_idx + 1]++;
+        for (int j = 0; j < num_items; j++)
+            partition->item_ptr[t][j + 1] += partition->item_ptr[t][j];
+    }
+    return partition;
+}
+
+//
+// @brief: The observed (non-zero) entries of a dense rating matrix, by row
+//
+vector<Rating> ratings_of_matrix(const vector<vector<double>> &A) {
+    vector<Rating> ratings;
+    for (int i = 0; i < (int)A.size(); i++)
+        for (int j = 0; j < (int)A[i].size(); j++)
+            if (A[i][j] != 0.0)
+                ratings.push_back(Rating{i, j, A[i][j]});
+    return ratings;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Default operations
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SharedMemoryTrainer::SharedMemoryTrainer(int num_threads, int num_users,
+                                         int num_items, int num_embeddings,
+                                         double _alpha_, double _beta_, double _lambda_,
+                                         const vector<vector<double>> &A, unsigned random_seed,
+                                         const MemoryPolicy &policy)
+    : SharedMemoryTrainer(partition_ratings(ratings_of_matrix(A), num_users, num_items, num_threads),
+                          num_embeddings, _alpha_, _beta_, _lambda_, random_seed, policy) {
+
+    printf(">\tA shared-memory trainer is created with: num_threads=%d, num_embed=%d, rand_state=%u! \n",
+           this->num_threads, this->num_embeddings, this->random_seed);
+    printf(">\tMemory: %s\n", this->get_memory_report().c_str());
+}
+
+SharedMemoryTrainer::SharedMemoryTrainer(shared_ptr<const RatingPartition> partition,
+                                         int num_embeddings,
+                                         double _alpha_, double _beta_, double _lambda_,
+                                         unsigned random_seed,
+                                         const MemoryPolicy &policy)
+    : num_threads       {partition->num_threads},
+      num_users         {partition->num_users},
+      num_items         {partition->num_items},
+      num_embeddings    {num_embeddings},
+      _alpha_           {_alpha_},
+      _beta_            {_beta_},
+      _lambda_          {_lambda_},
+      random_seed       {random_seed},
+      policy            (policy),
+      W                 ((size_t)partition->num_users * num_embeddings, policy.page_size, false),
+      H                 ((size_t)partition->num_items * num_embeddings, policy.page_size,
+                         policy.numa == NumaPlacement::INTERLEAVE),
+      partition         (partition),
+      token_hops        (partition->num_items, 0) {
+
+    assert(this->num_threads > 0);
+    assert(this->num_users > 0);
+    assert(this->num_items > 0);
+    assert(0 < num_embeddings && num_embeddings < min(this->num_users, this->num_items));
+
+    this->initialize_factors();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SGD Model functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Hogwild: every thread runs SGD over its own ratings in random
+// order, writing its own rows of W and the shared H without any lock
+//
+void SharedMemoryTrainer::train_hogwild(int num_epochs) {
+    vector<thread> threads;
+    for (int t = 0; t < this->num_threads; t++)
+        threads.emplace_back(&SharedMemoryTrainer::run_hogwild_thread, this, t, num_epochs);
+    for (auto &th : threads)
+        th.join();
+    this->num_epochs_done += num_epochs;
+    return;
+}
+
+//
+// @brief: NOMAD ring: item tokens circulate thread t -> t+1 through SPSC
+// queues, so H_j is only ever written by the thread holding token j
+//
+void SharedMemoryTrainer::train_nomad_ring(int num_epochs) {
+    this->queues.clear();
+    for (int t = 0; t < this->num_threads; t++)
+        this->queues.emplace_back(new SpscQueue(this->num_items + 1));
+
+    // Initialize the queue of each thread in a round-robin manner
+    fill(this->token_hops.begin(), this->token_hops.end(), 0);
+    for (int j = 0; j < this->num_items; j++)
+        this->queues[j % this->num_threads]->push(j);
+
+    vector<thread> threads;
+    for (int t = 0; t < this->num_threads; t++)
+        threads.emplace_back(&SharedMemoryTrainer::run_nomad_thread, this, t, num_epochs);
+    for (auto &th : threads)
+        th.join();
+    this->num_epochs_done += num_epochs;
+    return;
+}
+
+//
+// @brief: Compute the RMSE over all observed ratings
+//
+double SharedMemoryTrainer::compute_train_rmse() {
+    double sse = 0.0;
+    long long int cnt = 0;
+    for (auto &ratings : this->partition->thread_ratings) {
+        for (auto &rating : ratings) {
+            double dot = 0.0;
+            for (int k = 0; k < this->num_embeddings; k++)
+                dot += this->W[rating.user_idx * this->num_embeddings + k] *
+                       this->H[rating.item_idx * this->num_embeddings + k];
+            sse += (dot - rating.value) * (dot - rating.value);
+            cnt++;
+        }
+    }
+    return (cnt > 0) ? sqrt(sse / cnt) : 0.0;
+}
+
+//
+// @brief: Compute the RMSE over held-out ratings (e.g. a validation set)
+//
+double SharedMemoryTrainer::compute_rmse(const vector<Rating> &ratings) const {
+    double sse = 0.0;
+    for (auto &rating : ratings) {
+        double dot = 0.0;
+        for (int k = 0; k < this->num_embeddings; k++)
+            dot += this->W[rating.user_idx * this->num_embeddings + k] *
+                   this->H[rating.item_idx * this->num_embeddings + k];
+        sse += (dot - rating.value) * (dot - rating.value);
+    }
+    return ratings.empty() ? 0.0 : sqrt(sse / ratings.size());
+}
+
+//
+// @brief: Compute approximate matrix A
+//
+vector<vector<double>> SharedMemoryTrainer::compute_approximate_A() {
+    vector<vector<double>> _A_(this->num_users, vector<double>(this->num_items, 0.0));
+
+    // Perform matrix multiplication: A_ij = W_i * H_j
+    for (int i = 0; i < this->num_users; i++) {
+        for (int j = 0; j < this->num_items; j++) {
+            for (int k = 0; k < this->num_embeddings; k++) {
+                _A_[i][j] += (this->W[i * this->num_embeddings + k] * this->H[j * this->num_embeddings + k]);
+            }
+        }
+    }
+    return _A_;
+}
+
+//
+// @brief: The memory policy and the pages granted to W and H
+//
+string SharedMemoryTrainer::get_memory_report() const {
+    return memory_policy_name(this->policy) + "; W: " + this->W.get_granted() + "; H: " + this->H.get_granted();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Private SGD update functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Initialize W and H using random uniform distribution on real
+// values. Every thread writes first the rows of W of its users and the rows
+// of H of the tokens it starts with, so that under a NUMA policy their pages
+// live on its node; the values (counter-based) do not depend on the threads
+//
+void SharedMemoryTrainer::initialize_factors() {
+    double scale = (double)1.0 / sqrt((double)1.0 * this->num_embeddings);
+    auto initialize_thread = [this, scale](int thread_id) {
+        this->place_thread(thread_id);
+        for (int usr_idx : this->partition->thread_users[thread_id]) {
+            uint64_t row = (uint64_t)usr_idx * this->num_embeddings;
+            for (int k = 0; k < this->num_embeddings; k++)
+                this->W[row + k] = scale * counter_uniform(this->random_seed, RNG_STREAM_W, row + k);
+        }
+        for (int j = thread_id; j < this->num_items; j += this->num_threads) {
+            uint64_t row = (uint64_t)j * this->num_embeddings;
+            for (int k = 0; k < this->num_embeddings; k++)
+                this->H[row + k] = scale * counter_uniform(this->random_seed, RNG_STREAM_H, row + k);
+        }
+    };
+
+    vector<thread> threads;
+    for (int t = 0; t < this->num_threads; t++)
+        threads.emplace_back(initialize_thread, t);
+    for (auto &th : threads)
+        th.join();
+    return;
+}
+
+//
+// @brief: Pin the calling thread under a NUMA policy, so that thread t
+// always runs where its rows were first written
+//
+void SharedMemoryTrainer::place_thread(int thread_id) {
+    if (this->policy.numa != NumaPlacement::DEFAULT)
+        pin_thread_to_cpu(thread_id);
+}
+
+//
+// @brief: Compute the new learning rate w.r.t to the time step
+//
+double SharedMemoryTrainer::compute_learning_rate(int time) {
+    double lr = this->_alpha_ / (1.0 + this->_beta_ * pow((double)1.0 * time, 0.5));
+    return lr;
+}
+
+//
+// @brief: One SGD step on rating A_ij with L2 regularization
+//
+void SharedMemoryTrainer::sgd_update(int user_idx, int item_idx, double rating, double lr) {
+    double *W_i = &this->W[user_idx * this->num_embeddings];
+    double *H_j = &this->H[item_idx * this->num_embeddings];
+
+    double err = -rating;
+    for (int k = 0; k < this->num_embeddings; k++)
+        err += W_i[k] * H_j[k];
+
+    for (int k = 0; k < this->num_embeddings; k++) {
+        double w_ik = W_i[k];
+        double h_jk = H_j[k];
+        W_i[k] = w_ik - lr * (err * h_jk + this->_lambda_ * w_ik);
+        H_j[k] = h_jk - lr * (err * w_ik + this->_lambda_ * h_jk);
+    }
+    return;
+}
+
+//
+// @brief: Body of a Hogwild thread
+//
+void SharedMemoryTrainer::run_hogwild_thread(int thread_id, int num_epochs) {
+    this->place_thread(thread_id);
+    std::default_random_engine random_engine(this->random_seed + 1234567890u * (thread_id + 1));
+    const vector<Rating> &ratings = this->partition->thread_ratings[thread_id];
+    vector<int> order(ratings.size());
+    for (int p = 0; p < (int)order.size(); p++)
+        order[p] = p;
+
+    for (int epoch = 1; epoch <= num_epochs; epoch++) {
+        double lr = this->compute_learning_rate(this->num_epochs_done + epoch);
+        shuffle(order.begin(), order.end(), random_engine);
+        for (int p : order)
+            this->sgd_update(ratings[p].user_idx, ratings[p].item_idx, ratings[p].value, lr);
+    }
+
+    this->num_updates += (long long int)num_epochs * ratings.size();
+    return;
+}
+
+//
+// @brief: Body of a NOMAD ring thread. Every token visits every thread
+// exactly 'num_epochs' times, then it is retired
+//
+void SharedMemoryTrainer::run_nomad_thread(int thread_id, int num_epochs) {
+    this->place_thread(thread_id);
+    const vector<Rating> &ratings = this->partition->thread_ratings[thread_id];
+    const vector<int> &item_ptr = this->partition->item_ptr[thread_id];
+    SpscQueue &inbox = *this->queues[thread_id];
+    SpscQueue &outbox = *this->queues[(thread_id + 1) % this->num_threads];
+
+    long long int local_updates = 0;
+    long long int remaining = (long long int)num_epochs * this->num_items;
+    long long int max_hops = (long long int)num_epochs * this->num_threads;
+    while (remaining > 0) {
+        int item_idx;
+        if (inbox.pop(item_idx) == false) {
+            this_thread::yield();
+            continue;
+        }
+
+        int epoch = this->num_epochs_done + this->token_hops[item_idx] / this->num_threads + 1;
+        double lr = this->compute_learning_rate(epoch);
+        for (int p = item_ptr[item_idx]; p < item_ptr[item_idx + 1]; p++)
+            this->sgd_update(ratings[p].user_idx, item_idx, ratings[p].value, lr);
+        local_updates += item_ptr[item_idx + 1] - item_ptr[item_idx];
+
+        remaining--;
+        if (++this->token_hops[item_idx] < max_hops) {
+            while (outbox.push(item_idx) == false)
+                this_thread::yield();
+        }
+    }
+
+    this->num_updates += local_updates;
+    return;
+}
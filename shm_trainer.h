@@ -0,0 +1,151 @@
+//
+// @file    : shm_trainer.h
+// @purpose : A definition class for the single-node shared-memory trainer
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHM_TRAINER_H_
+#define SHM_TRAINER_H_
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include "data_io.h"
+#include "memory_policy.h"
+#include "rng.h"
+using namespace std;
+
+//
+// @brief: Lock-free single-producer/single-consumer ring of item indices.
+// The producer is the previous thread in the ring, the consumer is the owner
+//
+class SpscQueue {
+
+public:
+    SpscQueue()                             = default;
+    explicit SpscQueue(int capacity);
+
+    SpscQueue(const SpscQueue& old)         = delete;
+    SpscQueue& operator=(const SpscQueue& old) = delete;
+
+    bool                    push(int item_idx);
+    bool                    pop(int &item_idx);
+
+private:
+    vector<int>                                     buffer;
+    size_t                                          mask            { 0 };
+    alignas(64) atomic<size_t>                      head            { 0 };  // next slot to pop
+    alignas(64) atomic<size_t>                      tail            { 0 };  // next slot to push
+};
+
+//
+// @brief: Read-only ratings split by user across 'num_threads' threads with
+// balanced number of ratings (thread_users[t] are the users of thread t),
+// sorted by item so that
+// thread_ratings[t][item_ptr[t][j] .. item_ptr[t][j+1]) are the ratings of item j.
+// Several trainers (e.g. the trials of a sweep) can share one partition
+//
+struct RatingPartition {
+    int                                             num_threads     { 0 };
+    int                                             num_users       { 0 };
+    int                                             num_items       { 0 };
+    vector<vector<int>>                             thread_users;
+    vector<vector<Rating>>                          thread_ratings;
+    vector<vector<int>>                             item_ptr;
+};
+
+shared_ptr<const RatingPartition>   partition_ratings(const vector<Rating> &ratings, int num_users,
+                                                      int num_items, int num_threads);
+vector<Rating>                      ratings_of_matrix(const vector<vector<double>> &A);
+
+class SharedMemoryTrainer {
+
+public:
+    ///////////////////////////////////////////////////////
+    // Default operations
+    ///////////////////////////////////////////////////////
+    SharedMemoryTrainer()                   = default;
+
+    SharedMemoryTrainer(int num_threads, int num_users,     // User-defined constructor
+                        int num_items, int num_embeddings,
+                        double _alpha_, double _beta_, double _lambda_,
+                        const vector<vector<double>> &A, unsigned random_seed,
+                        const MemoryPolicy &policy = MemoryPolicy());
+
+    SharedMemoryTrainer(shared_ptr<const RatingPartition> partition,   // Share the ratings
+                        int num_embeddings,
+                        double _alpha_, double _beta_, double _lambda_,
+                        unsigned random_seed,
+                        const MemoryPolicy &policy = MemoryPolicy());
+
+    SharedMemoryTrainer(const SharedMemoryTrainer& old)             = delete;
+    SharedMemoryTrainer& operator=(const SharedMemoryTrainer& old)  = delete;
+    virtual ~SharedMemoryTrainer() noexcept                         = default;
+
+    ///////////////////////////////////////////////////////
+    // SGD Model functions
+    ///////////////////////////////////////////////////////
+    void                    train_hogwild(int num_epochs);
+    void                    train_nomad_ring(int num_epochs);
+    double                  compute_train_rmse();
+    double                  compute_rmse(const vector<Rating> &ratings) const;
+    int                     get_num_epochs() const { return this->num_epochs_done; }
+    vector<vector<double>>  compute_approximate_A();
+    long long int           get_num_updates() const { return this->num_updates.load(); }
+    string                  get_memory_report() const;
+
+private:
+    ///////////////////////////////////////////////////////
+    // Private SGD update functions
+    ///////////////////////////////////////////////////////
+    double                  compute_learning_rate(int time);
+    void                    sgd_update(int user_idx, int item_idx, double rating, double lr);
+    void                    run_hogwild_thread(int thread_id, int num_epochs);
+    void                    run_nomad_thread(int thread_id, int num_epochs);
+    void                    initialize_factors();
+    void                    place_thread(int thread_id);
+
+    ///////////////////////////////////////////////////////
+    // Member
+    ///////////////////////////////////////////////////////
+    int                                             num_threads     { -1 };
+    int                                             num_users       { -1 };
+    int                                             num_items       { -1 };
+    int                                             num_embeddings  { -1 };
+    double                                          _alpha_         { 0.0 };
+    double                                          _beta_          { 0.0 };
+    double                                          _lambda_        { 0.0 };
+    unsigned                                        random_seed     { 0 };
+    int                                             num_epochs_done { 0 };      // the learning rate continues across calls
+    MemoryPolicy                                    policy;
+
+    // Factors use the same row-major layout as the distributed engine:
+    // W[user_idx * num_embeddings + k], H[item_idx * num_embeddings + k]
+    PolicyArray<double>                             W;
+    PolicyArray<double>                             H;
+
+    // Ratings of the users owned by each thread (see RatingPartition)
+    shared_ptr<const RatingPartition>               partition;
+
+    vector<unique_ptr<SpscQueue>>                   queues;
+    vector<int>                                     token_hops;     // only touched by the token holder
+    atomic<long long int>                           num_updates     { 0 };
+};
+
+#endif // SHM_TRAINER_H_
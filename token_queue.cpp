@@ -0,0 +1,82 @@
+//
+// @file    : token_queue.cpp
+// @purpose : A implementation class for the work-ordered queue of item tokens
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "token_queue.h"
+
+//
+// @brief: Set the estimated work (number of local ratings) of every token.
+// Tokens already queued take their new cost and the current batch is ordered
+// again; returns the change of the pending work
+//
+long long int TokenQueue::set_token_work(vector<int> token_work) {
+    long long int old_pending = this->pending;
+    this->token_work = token_work;
+    this->pending = 0;
+    for (int token : this->current)
+        this->pending += this->cost(token);
+    for (int token : this->incoming)
+        this->pending += this->cost(token);
+    stable_sort(this->current.begin(), this->current.end(),
+                [this](int a, int b) { return this->cost(a) < this->cost(b); });
+    return this->pending - old_pending;
+}
+
+//
+// @brief: The cost of serving a token here: its local ratings plus one for
+// the hand-off, so that tokens without local work still count as load
+//
+long long int TokenQueue::cost(int token) const {
+    if (token < (int)this->token_work.size())
+        return 1 + this->token_work[token];
+    return 1;
+}
+
+//
+// @brief: Append a token to the next batch, return its cost
+//
+long long int TokenQueue::push(int token) {
+    this->incoming.push_back(token);
+    long long int c = this->cost(token);
+    this->pending += c;
+    return c;
+}
+
+//
+// @brief: Take the most expensive token of the current batch; when the batch
+// is exhausted, the tokens that arrived meanwhile become the next batch
+//
+int TokenQueue::pop() {
+    assert(this->empty() == false);
+    if (this->current.empty()) {
+        // Earlier arrivals end up closer to the back among tokens of equal work
+        this->current.assign(this->incoming.rbegin(), this->incoming.rend());
+        this->incoming.clear();
+        stable_sort(this->current.begin(), this->current.end(),
+                    [this](int a, int b) { return this->cost(a) < this->cost(b); });
+    }
+
+    int token = this->current.back();
+    this->current.pop_back();
+    this->pending -= this->cost(token);
+    return token;
+}
+
+//
+// @brief: All queued tokens: the current batch in serving order, then the
+// next batch in arrival order
+//
+vector<int> TokenQueue::snapshot() const {
+    vector<int> tokens(this->current.rbegin(), this->current.rend());
+    tokens.insert(tokens.end(), this->incoming.begin(), this->incoming.end());
+    return tokens;
+}
@@ -0,0 +1,54 @@
+//
+// @file    : token_queue.h
+// @purpose : A definition class for the work-ordered queue of item tokens
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TOKEN_QUEUE_H_
+#define TOKEN_QUEUE_H_
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+using namespace std;
+
+//
+// @brief: Queue of item tokens ordered by their estimated local work.
+// Tokens arriving while a batch is being served wait for the next batch, and
+// each batch is served from the most to the least expensive token, so that
+// cheap tokens are never starved by a stream of expensive ones
+//
+class TokenQueue {
+
+public:
+    TokenQueue()                            = default;
+    TokenQueue(const TokenQueue& old)       = default;
+    TokenQueue& operator=(const TokenQueue& old) = default;
+    TokenQueue(TokenQueue&& old)            = default;
+    TokenQueue& operator=(TokenQueue&& old) = default;
+
+    long long int           set_token_work(vector<int> token_work);
+    long long int           cost(int token) const;
+    long long int           push(int token);
+    int                     pop();
+    bool                    empty() const { return this->current.empty() && this->incoming.empty(); }
+    size_t                  size() const { return this->current.size() + this->incoming.size(); }
+    long long int           pending_work() const { return this->pending; }
+    vector<int>             snapshot() const;
+
+private:
+    vector<int>                                     current;        // sorted by increasing work, served from the back
+    vector<int>                                     incoming;       // in arrival order
+    vector<int>                                     token_work;     // local ratings of each token (empty: FIFO)
+    long long int                                   pending         { 0 };
+};
+
+#endif // TOKEN_QUEUE_H_
@@ -0,0 +1,170 @@
+//
+// @file    : tracer.cpp
+// @purpose : A implementation class for the token-flow tracer and its timeline export
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "tracer.h"
+#include <fstream>
+#include <map>
+#include <algorithm>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Default operations
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: A tracer keeping the latest 'capacity' records (rounded up to a
+// power of 2) of 1 in 'sample_every' tokens
+//
+TokenTracer::TokenTracer(size_t capacity, int sample_every)
+    : sample_every      {max(1, sample_every)},
+      origin            (std::chrono::steady_clock::now()) {
+
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    this->ring.resize(size);
+    this->mask = size - 1;
+}
+
+//
+// @brief: The records still in the ring, oldest first
+//
+vector<TraceRecord> TokenTracer::snapshot() const {
+    vector<TraceRecord> records;
+    uint64_t first = this->get_num_dropped();
+    records.reserve(this->next - first);
+    for (uint64_t p = first; p < this->next; p++)
+        records.push_back(this->ring[p & this->mask]);
+    return records;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Timeline export
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: One event of the Chrome trace format, with its time in microseconds
+//
+static string trace_event(const char *ph, const string &name, int pid, int tid, int64_t time_ns,
+                          const string &extra) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "\"pid\":%d,\"tid\":%d,\"ts\":%.3f", pid, tid, time_ns / 1000.0);
+    return "{\"ph\":\"" + string(ph) + "\",\"name\":\"" + name + "\"," + buffer + extra + "}";
+}
+
+static string token_label(int token, const vector<int> &token_item) {
+    if (token < 0 || token >= (int)token_item.size() || token_item[token] == token)
+        return "item " + to_string(token);
+    return "item " + to_string(token_item[token]) + " (token " + to_string(token) + ")";
+}
+
+//
+// @brief: Write the records of every rank as a Chrome trace / Perfetto JSON
+// file: one process per rank, with the pops, updates and idle periods on
+// thread 0 and the sends and receives on thread 1. A send and the receive
+// it caused are joined by a flow arrow: the k-th last send of a token to a
+// rank is matched with the k-th last receive of the token on that rank
+// (a token is in one place at a time, and the rings keep the latest records)
+//
+bool write_chrome_trace(const string &file, const vector<vector<TraceRecord>> &rank_records,
+                        const vector<int> &token_item) {
+    ofstream out(file, ios::out);
+    if (out.is_open() == false)
+        return false;
+
+    bool first_event = true;
+    auto emit = [&out, &first_event](const string &event) {
+        out << (first_event ? "\n" : ",\n") << event;
+        first_event = false;
+    };
+
+    // (token, receiver rank) -> (time, sender rank) of the sends, and the times of the receives
+    map<pair<int, int>, vector<pair<int64_t, int>>> sends;
+    map<pair<int, int>, vector<int64_t>> receives;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (int rank = 0; rank < (int)rank_records.size(); rank++) {
+        emit("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + to_string(rank) +
+             ",\"args\":{\"name\":\"rank " + to_string(rank) + "\"}}");
+        emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + to_string(rank) +
+             ",\"tid\":0,\"args\":{\"name\":\"tokens\"}}");
+        emit("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + to_string(rank) +
+             ",\"tid\":1,\"args\":{\"name\":\"transfers\"}}");
+
+        // Spans are emitted as complete events when they close, so that the
+        // spans cut by the ring are simply left out
+        const TraceRecord *update_begin = nullptr, *idle_begin = nullptr;
+        map<int, const TraceRecord*> send_begin;
+        for (auto &record : rank_records[rank]) {
+            string label = token_label(record.token, token_item);
+            switch (record.event) {
+            case TraceEvent::POP:
+                emit(trace_event("i", "pop " + label, rank, 0, record.time_ns,
+                                 ",\"s\":\"t\",\"args\":{\"token\":" + to_string(record.token) + "}"));
+                break;
+            case TraceEvent::UPDATE_BEGIN:
+                update_begin = &record;
+                break;
+            case TraceEvent::UPDATE_END:
+                if (update_begin != nullptr && update_begin->token == record.token)
+                    emit(trace_event("X", "update " + label, rank, 0, update_begin->time_ns,
+                                     ",\"dur\":" + to_string((record.time_ns - update_begin->time_ns) / 1000.0)));
+                update_begin = nullptr;
+                break;
+            case TraceEvent::IDLE_BEGIN:
+                idle_begin = &record;
+                break;
+            case TraceEvent::IDLE_END:
+                if (idle_begin != nullptr)
+                    emit(trace_event("X", "idle", rank, 0, idle_begin->time_ns,
+                                     ",\"dur\":" + to_string((record.time_ns - idle_begin->time_ns) / 1000.0)));
+                idle_begin = nullptr;
+                break;
+            case TraceEvent::SEND:
+                send_begin[record.token] = &record;
+                sends[make_pair(record.token, record.peer)].push_back(make_pair(record.time_ns, rank));
+                break;
+            case TraceEvent::SEND_DONE:
+                if (send_begin.count(record.token) > 0)
+                    emit(trace_event("X", "send " + label + " to rank " + to_string(record.peer), rank, 1,
+                                     send_begin[record.token]->time_ns,
+                                     ",\"dur\":" + to_string((record.time_ns - send_begin[record.token]->time_ns) / 1000.0)));
+                send_begin.erase(record.token);
+                break;
+            case TraceEvent::RECEIVE:
+                emit(trace_event("X", "receive " + label + " from rank " + to_string(record.peer), rank, 1,
+                                 record.time_ns, ",\"dur\":0"));
+                receives[make_pair(record.token, rank)].push_back(record.time_ns);
+                break;
+            }
+        }
+    }
+
+    // Flow arrows from the sends to the receives they caused
+    long long int flow_id = 0;
+    for (auto &entry : sends) {
+        auto found = receives.find(entry.first);
+        if (found == receives.end())
+            continue;
+        vector<pair<int64_t, int>> &from = entry.second;
+        vector<int64_t> &to = found->second;
+        sort(from.begin(), from.end());
+        sort(to.begin(), to.end());
+        size_t n = min(from.size(), to.size());
+        for (size_t k = 0; k < n; k++, flow_id++) {
+            const pair<int64_t, int> &send = from[from.size() - n + k];
+            string id = ",\"cat\":\"token\",\"id\":" + to_string(flow_id);
+            emit(trace_event("s", "token", send.second, 1, send.first, id));
+            emit(trace_event("f", "token", entry.first.second, 1, to[to.size() - n + k], id + ",\"bp\":\"e\""));
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,83 @@
+//
+// @file    : tracer.h
+// @purpose : A definition class for the token-flow tracer and its timeline export
+// @author  : Hung Ngoc Phan
+// @project : NOMAD algorithm for matrix completion with UPCXX
+// @licensed: N/A
+// @created : 19/10/2026
+// @modified: 19/10/2026
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRACER_H_
+#define TRACER_H_
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include "rng.h"
+using namespace std;
+
+//
+// @brief: Events of the life of a token on a rank; IDLE_BEGIN/IDLE_END
+// (token -1) bracket the periods where the queue of the rank is empty
+//
+enum class TraceEvent : uint8_t { POP, UPDATE_BEGIN, UPDATE_END, SEND, SEND_DONE, RECEIVE, IDLE_BEGIN, IDLE_END };
+
+struct TraceRecord {
+    int64_t                                         time_ns;        // since the origin of the tracer
+    int32_t                                         token;
+    int32_t                                         peer;           // receiver of SEND/SEND_DONE, sender of RECEIVE
+    TraceEvent                                      event;
+};
+
+//
+// @brief: Ring buffer of the trace records of one rank, keeping the latest
+// 'capacity' records. Every record of a rank is written by its master
+// persona (RPC handlers run inside its calls to progress), so the ring has
+// a single writer and needs neither lock nor atomic. Only the tokens with
+// (hash(token) % sample_every == 0) are traced, on every rank, so that a
+// sampled token is followed along its whole path
+//
+class TokenTracer {
+
+public:
+    TokenTracer()                           = default;                 // disabled
+    TokenTracer(size_t capacity, int sample_every);
+    TokenTracer(const TokenTracer& old)     = default;
+    TokenTracer& operator=(const TokenTracer& old) = default;
+    TokenTracer(TokenTracer&& old)          = default;
+    TokenTracer& operator=(TokenTracer&& old) = default;
+
+    bool                    enabled() const { return this->sample_every > 0; }
+    bool                    is_sampled(int token) const {
+        return this->sample_every == 1 ||
+               (this->sample_every > 1 && splitmix64((uint64_t)token) % this->sample_every == 0);
+    }
+    void                    start() { this->origin = std::chrono::steady_clock::now(); }
+    void                    record(TraceEvent event, int token, int peer = -1) {
+        if (token >= 0 ? this->is_sampled(token) : this->enabled()) {
+            int64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - this->origin).count();
+            this->ring[this->next++ & this->mask] = TraceRecord{time_ns, token, peer, event};
+        }
+    }
+    vector<TraceRecord>     snapshot() const;
+    uint64_t                get_num_dropped() const { return (this->next > this->ring.size()) ? this->next - this->ring.size() : 0; }
+
+private:
+    vector<TraceRecord>                             ring;
+    uint64_t                                        mask            { 0 };
+    uint64_t                                        next            { 0 };      // records written so far
+    int                                             sample_every    { 0 };      // 0: disabled
+    std::chrono::steady_clock::time_point           origin;
+};
+
+bool    write_chrome_trace(const string &file, const vector<vector<TraceRecord>> &rank_records,
+                           const vector<int> &token_item);
+
+#endif // TRACER_H_
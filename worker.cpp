@@ -5,7 +5,7 @@
 // @project : NOMAD algorithm for matrix completion with UPCXX
 // @licensed: N/A
 // @created : 03/07/2020
-// @modified: 09/07/2020
+// @modified: 19/10/2026
 //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -13,13 +13,28 @@
 
 #include "worker.h"
 
+//
+// @brief: Push a token into the queue of the calling process and publish the
+// new pending work in the shared segment (also used inside RPC handlers)
+//
+static void push_to_queue(TokenQueue &item_queue,
+                          upcxx::global_ptr<std::atomic<long long int>> pending_work,
+                          upcxx::global_ptr<std::atomic<long long int>> node_load,
+                          int token) {
+    long long int cost = item_queue.push(token);
+    pending_work.local()->fetch_add(cost, std::memory_order_relaxed);
+    if (node_load.is_null() == false)
+        node_load.local()->fetch_add(cost, std::memory_order_relaxed);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Default operations
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 Worker::Worker(int proc_id, int num_users,
                int num_items, int num_embeddings,
                double _alpha_, double _beta_, double _lambda_,
-               vector<int> user_index, vector<vector<double>> A)
+               vector<int> &&user_index, PolicyArray<double> &&A,
+               const MemoryPolicy &policy)
     : proc_id           {proc_id},
       num_users         {num_users},
       num_items         {num_items},
@@ -27,12 +42,18 @@ Worker::Worker(int proc_id, int num_users,
       _alpha_           {_alpha_},
       _beta_            {_beta_},
       _lambda_          {_lambda_},
-      update_step       {new int[(int)(user_index.size() * num_items)]},
-      user_index        (user_index),
-      A                 {A},
-      W                 (upcxx::new_array<double>(user_index.size() * num_embeddings)),
+      memory_policy     (policy),
+      update_step       (user_index.size() * num_items, policy.page_size, false),
+      user_index        (std::move(user_index)),
+      A                 (std::move(A)),
+      W                 (upcxx::new_array<double>(this->user_index->size() * num_embeddings)),
       H                 (upcxx::new_array<double>(num_items * num_embeddings)),
-      item_queue        (queue<int>()) {
+      item_queue        (TokenQueue()),
+      item_ratings      (vector<Rating>()),
+      H_node            (upcxx::global_ptr<double>(nullptr)),
+      pending_work      (upcxx::new_<std::atomic<long long int>>(0)),
+      node_load         (upcxx::global_ptr<std::atomic<long long int>>(nullptr)),
+      tracer            (TokenTracer()) {
 
     assert(proc_id != -1);
     assert(num_users > 0);
@@ -43,17 +64,30 @@ Worker::Worker(int proc_id, int num_users,
     this->random_seed = std::chrono::system_clock::now().time_since_epoch().count() + 1234567890 * this->proc_id;
     this->random_engine = std::default_random_engine(this->random_seed);
     this->randomer = std::uniform_int_distribution<int>(0, upcxx::rank_n() - 1);
-    memset(this->update_step, 0, (int)(this->user_index->size() * num_items));
 
-    // Initialize kernel W in global share memory
-    this->initialize_W_uniform_random();
-
-    // Initialize kernel H in global share memory by proc-0
-    if (this->proc_id == 0) {
-        this->initialize_H_uniform_random();
-        // printf(">>>\tA worker with id=%d performed init matrix H !\n", this->proc_id);
+    // The rows of A come mapped by the loader; W and H live in the shared
+    // segment, where huge pages can only be advised
+    assert(this->A.size() == this->user_index->size() * num_items);
+    this->memory_granted = "A: " + this->A.get_granted() + "; update_step: " + this->update_step.get_granted();
+    if (policy.page_size != PageSize::DEFAULT) {
+        this->memory_granted += "; W: " + advise_huge_pages(this->W->local(), this->user_index->size() * num_embeddings * sizeof(double));
+        this->memory_granted += "; H: " + advise_huge_pages(this->H->local(), (size_t)num_items * num_embeddings * sizeof(double));
     }
 
+    // Every item is a single token until setup_scheduling splits the hot ones
+    this->num_tokens = num_items;
+    this->token_item.resize(num_items);
+    for (int j = 0; j < num_items; j++)
+        this->token_item[j] = j;
+    this->token_slot.assign(num_items, 0);
+    this->item_split.assign(num_items, 1);
+    this->first_subtoken.assign(num_items, -1);
+    this->hot_index.assign(num_items, -1);
+
+    // Keep a sparse view of the local rows of A
+    // (W and H are initialized by the collective initialize_factors)
+    this->build_local_ratings();
+
     printf(">\tA worker with id=%d is created with: num_embed=%d, rand_state=%u! \n",
            this->proc_id, this->num_embeddings, this->random_seed);
 }
@@ -61,37 +95,213 @@ Worker::Worker(int proc_id, int num_users,
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // SGD-NOMAD Model functions
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Initialize W and H (collective). The seed of proc-0 is used by
+// every process, and every value is drawn from a counter-based stream, so
+// the factors only depend on the seed, not on the number of processes
+//
+void Worker::initialize_factors(InitMode mode, uint64_t seed) {
+    this->init_seed = upcxx::broadcast(seed, 0).wait();
+
+    if (mode == InitMode::UNIFORM) {
+        this->initialize_W_uniform_random();
+        this->initialize_H_uniform_random();
+    } else if (mode == InitMode::ITEM_MEAN) {
+        this->initialize_item_mean();
+    } else {
+        this->initialize_truncated_svd();
+    }
+    upcxx::barrier();
+}
+
 //
 // @brief: Initialize matrix W using random uniform distribution on real values
 //
 void Worker::initialize_W_uniform_random() {
     double *w_ptr = this->W->local();
-    std::uniform_real_distribution<double> distribution((double)0.0,
-                                                        (double)1.0 / sqrt((double)1.0 * this->num_embeddings));
+    double scale = (double)1.0 / sqrt((double)1.0 * this->num_embeddings);
 
     for (int i = 0; i < (int)this->user_index->size(); i++) {
+        uint64_t row = (uint64_t)this->user_index->at(i) * this->num_embeddings;
         for (int j = 0; j < this->num_embeddings; j++) {
             int flatten_idx = i * (this->num_embeddings) + j;
-            w_ptr[flatten_idx] = distribution(this->random_engine);
+            w_ptr[flatten_idx] = scale * counter_uniform(this->init_seed, RNG_STREAM_W, row + j);
         }
     }
     return;
 }
 
 //
-// @brief: Initialize matrix H using random uniform distribution on real values
+// @brief: Initialize matrix H using random uniform distribution on real
+// values: every process fills its own shard of rows (collective)
 //
 void Worker::initialize_H_uniform_random() {
-    double *h_ptr = this->H->local();
-    std::uniform_real_distribution<double> distribution((double)0.0,
-                                                        (double)1.0 / sqrt((double)1.0 * this->num_embeddings));
+    int first_item, last_item;
+    this->get_item_shard(first_item, last_item);
+    double scale = (double)1.0 / sqrt((double)1.0 * this->num_embeddings);
 
-    for (int i = 0; i < (int)this->num_items; i++) {
+    vector<double> rows((last_item - first_item) * this->num_embeddings);
+    for (int i = first_item; i < last_item; i++) {
         for (int j = 0; j < this->num_embeddings; j++) {
-            int flatten_idx = i * (this->num_embeddings) + j;
-            h_ptr[flatten_idx] = distribution(this->random_engine);
+            uint64_t flatten_idx = (uint64_t)i * (this->num_embeddings) + j;
+            rows[(i - first_item) * this->num_embeddings + j] =
+                scale * counter_uniform(this->init_seed, RNG_STREAM_H, flatten_idx);
+        }
+    }
+    this->put_H_shard(rows, first_item, last_item);
+    return;
+}
+
+//
+// @brief: Warm start from the means: every entry of W_i is sqrt(mu_i / K) and
+// every entry of H_j is sqrt(mu_j / K), with +/-10% noise to break the
+// symmetry, so that W_i * H_j ~ sqrt(mu_i * mu_j). Users and items without
+// ratings use the global mean (collective)
+//
+void Worker::initialize_item_mean() {
+    int K = this->num_embeddings;
+
+    // Sum and count of the ratings of every item over all processes
+    vector<double> partial(2 * this->num_items, 0.0);
+    vector<double> total(2 * this->num_items, 0.0);
+    for (auto &ratings : this->local_ratings) {
+        for (auto &rating : ratings) {
+            partial[2 * rating.first] += rating.second;
+            partial[2 * rating.first + 1] += 1.0;
+        }
+    }
+    upcxx::reduce_all(partial.data(), total.data(), total.size(), upcxx::op_fast_add).wait();
+
+    double sum = 0.0, cnt = 0.0;
+    for (int j = 0; j < this->num_items; j++) {
+        sum += total[2 * j];
+        cnt += total[2 * j + 1];
+    }
+    double global_mean = (cnt > 0.0) ? sum / cnt : 0.0;
+
+    double *w_ptr = this->W->local();
+    for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+        double mu = global_mean;
+        if (this->local_ratings[i].empty() == false) {
+            mu = 0.0;
+            for (auto &rating : this->local_ratings[i])
+                mu += rating.second;
+            mu /= this->local_ratings[i].size();
+        }
+        uint64_t row = (uint64_t)this->user_index->at(i) * K;
+        for (int k = 0; k < K; k++)
+            w_ptr[i * K + k] = sqrt(max(mu, 0.0) / K) *
+                               (0.9 + 0.2 * counter_uniform(this->init_seed, RNG_STREAM_W, row + k));
+    }
+
+    int first_item, last_item;
+    this->get_item_shard(first_item, last_item);
+    vector<double> rows((last_item - first_item) * K);
+    for (int j = first_item; j < last_item; j++) {
+        double mu = (total[2 * j + 1] > 0.0) ? total[2 * j] / total[2 * j + 1] : global_mean;
+        for (int k = 0; k < K; k++)
+            rows[(j - first_item) * K + k] = sqrt(max(mu, 0.0) / K) *
+                (0.9 + 0.2 * counter_uniform(this->init_seed, RNG_STREAM_H, (uint64_t)j * K + k));
+    }
+    this->put_H_shard(rows, first_item, last_item);
+    return;
+}
+
+//
+// @brief: Warm start from a randomized truncated SVD A ~ U S V^T of the
+// zero-filled rating matrix (Halko et al.), with W = U S^1/2, H = V S^1/2.
+// The rows of the sketch Y = A (A^T A) Omega stay with their owners; only
+// l x l and num_items x l matrices are reduced over the processes (collective)
+//
+void Worker::initialize_truncated_svd() {
+    int K = this->num_embeddings;
+    int l = min(K + 10, min(this->num_users, this->num_items));
+    int n_local = (int)this->local_ratings.size();
+
+    // Gaussian test matrix Omega (num_items x l), the same on every process
+    vector<double> Omega(this->num_items * l);
+    for (int j = 0; j < this->num_items; j++)
+        for (int c = 0; c < l; c++)
+            Omega[j * l + c] = counter_normal(this->init_seed, RNG_STREAM_SKETCH, (uint64_t)j * l + c);
+
+    // Y = A Omega, then one power iteration Y = A (A^T Y)
+    vector<double> Y(n_local * l, 0.0);
+    for (int i = 0; i < n_local; i++)
+        for (auto &rating : this->local_ratings[i])
+            for (int c = 0; c < l; c++)
+                Y[i * l + c] += rating.second * Omega[rating.first * l + c];
+
+    vector<double> partial(this->num_items * l, 0.0);
+    vector<double> Z(this->num_items * l, 0.0);
+    for (int i = 0; i < n_local; i++)
+        for (auto &rating : this->local_ratings[i])
+            for (int c = 0; c < l; c++)
+                partial[rating.first * l + c] += rating.second * Y[i * l + c];
+    upcxx::reduce_all(partial.data(), Z.data(), Z.size(), upcxx::op_fast_add).wait();
+
+    fill(Y.begin(), Y.end(), 0.0);
+    for (int i = 0; i < n_local; i++)
+        for (auto &rating : this->local_ratings[i])
+            for (int c = 0; c < l; c++)
+                Y[i * l + c] += rating.second * Z[rating.first * l + c];
+
+    // Q = orth(Y), twice for stability
+    this->orthonormalize_rows(Y, l);
+    this->orthonormalize_rows(Y, l);
+
+    // B^T = A^T Q (num_items x l)
+    vector<double> Bt(this->num_items * l, 0.0);
+    fill(partial.begin(), partial.end(), 0.0);
+    for (int i = 0; i < n_local; i++)
+        for (auto &rating : this->local_ratings[i])
+            for (int c = 0; c < l; c++)
+                partial[rating.first * l + c] += rating.second * Y[i * l + c];
+    upcxx::reduce_all(partial.data(), Bt.data(), Bt.size(), upcxx::op_fast_add).wait();
+
+    // B B^T = U_B S^2 U_B^T, computed identically on every process
+    vector<double> S(l * l, 0.0);
+    for (int j = 0; j < this->num_items; j++) {
+        const double *b = &Bt[j * l];
+        for (int a = 0; a < l; a++)
+            for (int c = a; c < l; c++)
+                S[a * l + c] += b[a] * b[c];
+    }
+    for (int a = 0; a < l; a++)
+        for (int c = a + 1; c < l; c++)
+            S[c * l + a] = S[a * l + c];
+
+    vector<double> eigvals, U;
+    this->symmetric_eigen(S, l, eigvals, U);
+    vector<double> sqrt_sigma(K, 0.0);
+    for (int k = 0; k < K; k++)
+        sqrt_sigma[k] = sqrt(sqrt(max(eigvals[k], 0.0)));
+
+    // W = Q U_B S^1/2 (local rows)
+    double *w_ptr = this->W->local();
+    for (int i = 0; i < n_local; i++) {
+        for (int k = 0; k < K; k++) {
+            double v = 0.0;
+            for (int c = 0; c < l; c++)
+                v += Y[i * l + c] * U[c * l + k];
+            w_ptr[i * K + k] = v * sqrt_sigma[k];
         }
     }
+
+    // H = V S^1/2 = B^T U_B S^-1/2 (own shard)
+    int first_item, last_item;
+    this->get_item_shard(first_item, last_item);
+    vector<double> rows((last_item - first_item) * K, 0.0);
+    for (int j = first_item; j < last_item; j++) {
+        for (int k = 0; k < K; k++) {
+            if (sqrt_sigma[k] < 1e-12)
+                continue;
+            double v = 0.0;
+            for (int c = 0; c < l; c++)
+                v += Bt[j * l + c] * U[c * l + k];
+            rows[(j - first_item) * K + k] = v / sqrt_sigma[k];
+        }
+    }
+    this->put_H_shard(rows, first_item, last_item);
     return;
 }
 
@@ -99,7 +309,7 @@ void Worker::initialize_H_uniform_random() {
 // @brief: Add a new item index to item queue locally
 //
 void Worker::add_item_idx_to_queue(int item_idx) {
-    this->item_queue->push(item_idx);
+    push_to_queue(*this->item_queue, *this->pending_work, *this->node_load, item_idx);
     return;
 }
 
@@ -108,32 +318,122 @@ void Worker::add_item_idx_to_queue(int item_idx) {
 //
 void Worker::update(int epoch_idx) {
     if (this->item_queue->empty() == false)     {
+        if (this->tracing_idle) {
+            this->tracer->record(TraceEvent::IDLE_END, -1);
+            this->tracing_idle = false;
+        }
+
         // Get the first item index from the queue
-        int item_idx = this->item_queue->front();
-        this->item_queue->pop();
+        int item_idx = this->pop_item_from_queue();
+        this->tracer->record(TraceEvent::POP, item_idx);
 
         // Compute new value of W and H
         // Remote update H using global_ptr
+        this->tracer->record(TraceEvent::UPDATE_BEGIN, item_idx);
         this->update_value_W_and_H(item_idx);
+        this->tracer->record(TraceEvent::UPDATE_END, item_idx);
 
         // Transfer the item to another process
         // int receiver_id = this->randomer(this->random_engine);
-        int receiver_id = this->get_priority_process_index();
-        this->transfer_item(receiver_id, item_idx).wait();
+        if (this->hierarchical) {
+            this->route_item(item_idx);
+        } else {
+            int receiver_id = this->get_priority_process_index();
+            this->transfer_item(receiver_id, item_idx).wait();
+        }
 
         // Print to debug the transfer process
         // if (upcxx::rank_me() == this->proc_id)
         // printf("Proc-id=%02d: item=%02d\t|||\treceiver=%02d\n", this->proc_id, item_idx, receiver_id);
+    } else {
+        // Nothing to do locally: release the tokens waiting for a cross-node
+        // batch and let incoming tokens arrive
+        if (this->tracing_idle == false && this->tracer->enabled()) {
+            this->tracer->record(TraceEvent::IDLE_BEGIN, -1);
+            this->tracing_idle = true;
+        }
+        auto idle_start = std::chrono::steady_clock::now();
+        if (this->hierarchical)
+            this->flush_remote_batches();
+        upcxx::progress();
+        this->idle_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - idle_start).count();
+    }
+    return;
+}
+
+//
+// @brief: Reproducible runs: the seed of every process is derived from
+// 'seed' and its id instead of the clock, and the tokens follow the
+// lockstep ring of update_lockstep
+//
+void Worker::set_reproducible(uint64_t seed) {
+    this->reproducible = true;
+    this->random_seed = (unsigned)counter_hash(seed, RNG_STREAM_RANK, this->proc_id);
+    this->random_engine = std::default_random_engine(this->random_seed);
+    return;
+}
+
+//
+// @brief: Serve the tokens of every queue in arrival order instead of by
+// local work: on the lockstep ring, a process holding n tokens then serves
+// each of them within n rounds of its arrival (incremental training)
+//
+void Worker::set_fifo_queues() {
+    this->fifo_queues = true;
+    this->update_token_work();
+    return;
+}
+
+//
+// @brief: One lockstep round of a reproducible run (collective): every
+// process takes the next token of its queue, serves it and passes it to the
+// next process of the ring. The barriers run progress, so the tokens must
+// not arrive while a queue is read: every process pops before the first
+// barrier, and the tokens of the round are sent after it and have landed
+// before the second one. Every queue then receives at most one token per
+// round, between its pops, and the schedule only depends on the initial
+// queues, not on timing
+//
+void Worker::update_lockstep(int epoch_idx) {
+    int receiver_id = (this->proc_id + 1) % upcxx::rank_n();
+    int item_idx = -1;
+    if (this->item_queue->empty() == false) {
+        item_idx = this->pop_item_from_queue();
+        this->tracer->record(TraceEvent::POP, item_idx);
     }
+    upcxx::barrier();
+
+    if (item_idx >= 0) {
+        this->tracer->record(TraceEvent::UPDATE_BEGIN, item_idx);
+        this->update_value_W_and_H(item_idx);
+        this->tracer->record(TraceEvent::UPDATE_END, item_idx);
+
+        // The row of H travels with the token when the receiver is on another node
+        bool same_node = (this->hierarchical == false) ||
+            find(this->node_members[this->node_id].begin(), this->node_members[this->node_id].end(),
+                 receiver_id) != this->node_members[this->node_id].end();
+        if (same_node)
+            this->transfer_item(receiver_id, item_idx).wait();
+        else
+            this->transfer_item_with_row(receiver_id, item_idx).wait();
+    }
+    upcxx::barrier();
     return;
 }
 
 //
-// @brief: Compute and update the new value of H and W
+// @brief: Compute and update the new value of H and W for the users served
+// by a token; the row of H used is the row of the token
 //
-void Worker::update_value_W_and_H(int item_index) {
+void Worker::update_value_W_and_H(int token) {
+    int item_index = this->token_item[token];
+    int split = this->item_split[item_index];
+    int slot = this->token_slot[token];
+
     for (int i = 0; i < user_index->size(); i++) {
-        if (A[i][item_index] == 0.0)
+        if (A[(size_t)i * this->num_items + item_index] == 0.0)
+            continue;
+        if (split > 1 && user_index->at(i) % split != slot)
             continue;
 
         // Compute the learning rate w.r.t to the time step
@@ -141,7 +441,8 @@ void Worker::update_value_W_and_H(int item_index) {
         double lr = compute_learning_rate(t);
 
         // Prepare A[i][j], W[i] and H[j]
-        double A_ij = A[i][item_index];
+        double A_ij = A[(size_t)i * this->num_items + item_index];
+        this->num_updates++;
 
         vector<double> W_i(this->num_embeddings);
         upcxx::global_ptr<double> W_glptr = this->W.fetch(upcxx::rank_me()).wait();
@@ -149,15 +450,17 @@ void Worker::update_value_W_and_H(int item_index) {
         double *W_ptr = W_glptr.local();
 
         vector<double> H_j(this->num_embeddings);
-        upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+        upcxx::global_ptr<double> H_glptr = *this->H_node;
         assert(H_glptr.is_local());
         double *H_ptr = H_glptr.local();
 
         for (int k = 0; k < this->num_embeddings; k++) {
             W_i[k] = W_ptr[i * this->num_embeddings + k];
-            H_j[k] = H_ptr[item_index * this->num_embeddings + k];
+            H_j[k] = H_ptr[token * this->num_embeddings + k];
         }
 
+        bool update_W_i = this->frozen_user.empty() || this->frozen_user[i] == 0;
+
         // SGD update on W_i, H_j
         vector<double> W_i_t = 
             vec_vec_subtract(
@@ -206,14 +509,16 @@ void Worker::update_value_W_and_H(int item_index) {
         // use upcxx::rput(src,dst,size)
         double* W_i_t_arr = &W_i_t[0];
         double* H_j_t_arr = &H_j_t[0];
-        upcxx::rput(
-            W_i_t_arr,
-            W_glptr + (i * this->num_embeddings),
-            this->num_embeddings
-        ).wait();
+        if (update_W_i) {
+            upcxx::rput(
+                W_i_t_arr,
+                W_glptr + (i * this->num_embeddings),
+                this->num_embeddings
+            ).wait();
+        }
         upcxx::rput(
             H_j_t_arr,
-            H_glptr + (item_index * this->num_embeddings),
+            H_glptr + (token * this->num_embeddings),
             this->num_embeddings
         ).wait();
 
@@ -226,26 +531,36 @@ void Worker::update_value_W_and_H(int item_index) {
 // @brief: Push the item index to another process
 //
 upcxx::future<> Worker::transfer_item(int worker_id, int item_index) {
+    this->bytes_sent += sizeof(int);
+    this->tracer->record(TraceEvent::SEND, item_index, worker_id);
     return upcxx::rpc(
         worker_id,
-        [](upcxx::dist_object<queue<int>> &item_queue, int item_idx) {
-            item_queue->push(item_idx);
+        [](upcxx::dist_object<TokenQueue> &item_queue,
+           upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &pending_work,
+           upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &node_load,
+           upcxx::dist_object<TokenTracer> &tracer,
+           int item_idx, int sender_id) {
+            tracer->record(TraceEvent::RECEIVE, item_idx, sender_id);
+            push_to_queue(*item_queue, *pending_work, *node_load, item_idx);
         },
-        item_queue, item_index);
+        item_queue, pending_work, node_load, tracer, item_index, upcxx::rank_me()).then(
+        [this, worker_id, item_index]() {
+            this->tracer->record(TraceEvent::SEND_DONE, item_index, worker_id);
+        });
 }
 
 //
 // @brief: Dynamic Load Balancing: Get the index of
-// process/worker that have the least amount of items
+// process/worker that have the least amount of pending work
 //
 int Worker::get_priority_process_index() {
-    int min_capac = this->num_items;
+    long long int min_capac = LLONG_MAX;
     int min_proc_id = -1;
     for (int id = 0; id < upcxx::rank_n(); id++)     {
-        int remote_capac = upcxx::rpc(
+        long long int remote_capac = upcxx::rpc(
                             id,
-                            [](upcxx::dist_object<queue<int>> &item_queue) {
-                                return (int)item_queue->size();
+                            [](upcxx::dist_object<TokenQueue> &item_queue) {
+                                return item_queue->pending_work();
                             },
                             item_queue).wait();
         if (remote_capac <= min_capac) {
@@ -296,6 +611,1024 @@ vector<vector<double>> Worker::compute_approximate_A() {
     return _A_;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Token routing functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Prepare the token routing (collective, after H is initialized).
+// Flat routing keeps the original behavior: one H on proc-0 and the least
+// loaded process of the whole job receives the token.
+// Hierarchical routing groups the ranks of upcxx::local_team() into nodes;
+// a node can be emulated on one machine by NOMAD_RANKS_PER_NODE=<n>, which
+// splits local_team into teams of n ranks. Rows of H sent between nodes are
+// encoded with 'codec'
+//
+void Worker::setup_routing(bool hierarchical, WireCodec codec) {
+    this->hierarchical = hierarchical;
+    this->wire_codec = codec;
+    upcxx::barrier();
+
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+    if (hierarchical == false) {
+        *this->H_node = H_glptr;
+        return;
+    }
+
+    // Ranks sharing memory form a node, optionally split into emulated nodes
+    this->node_team = &upcxx::local_team();
+    const char *ranks_per_node = getenv("NOMAD_RANKS_PER_NODE");
+    if (ranks_per_node != nullptr && atoi(ranks_per_node) > 0) {
+        int local_rank = upcxx::local_team().rank_me();
+        this->emulated_team = make_shared<upcxx::team>(
+            upcxx::local_team().split(local_rank / atoi(ranks_per_node), local_rank));
+        this->node_team = this->emulated_team.get();
+    }
+
+    // Topology: the members of every node, numbered by their leader
+    upcxx::dist_object<int> leader((*this->node_team)[0]);
+    vector<int> leader_to_node(upcxx::rank_n(), -1);
+    this->node_members.clear();
+    for (int id = 0; id < upcxx::rank_n(); id++) {
+        int leader_id = leader.fetch(id).wait();
+        if (leader_to_node[leader_id] == -1) {
+            leader_to_node[leader_id] = (int)this->node_members.size();
+            this->node_members.push_back(vector<int>());
+        }
+        this->node_members[leader_to_node[leader_id]].push_back(id);
+    }
+    this->node_id = leader_to_node[(*this->node_team)[0]];
+
+    // The leader allocates the node replica of H, the hop counters and the load counter
+    upcxx::global_ptr<double> node_H;
+    upcxx::global_ptr<int> node_hops_glptr;
+    upcxx::global_ptr<std::atomic<long long int>> node_load_glptr;
+    upcxx::global_ptr<double> node_error_glptr;
+    if (this->node_team->rank_me() == 0) {
+        if (this->proc_id == 0) {
+            node_H = H_glptr;
+        } else {
+            node_H = upcxx::new_array<double>(this->num_tokens * this->num_embeddings);
+            upcxx::rget(H_glptr, node_H.local(), this->num_tokens * this->num_embeddings).wait();
+        }
+        node_hops_glptr = upcxx::new_array<int>(this->num_tokens);
+        memset(node_hops_glptr.local(), 0, this->num_tokens * sizeof(int));
+        node_load_glptr = upcxx::new_<std::atomic<long long int>>(0);
+        if (codec != WireCodec::FP64) {
+            node_error_glptr = upcxx::new_array<double>(this->num_tokens * this->num_embeddings);
+            memset(node_error_glptr.local(), 0, this->num_tokens * this->num_embeddings * sizeof(double));
+        }
+    }
+    *this->H_node = upcxx::broadcast(node_H, 0, *this->node_team).wait();
+    this->node_hops = upcxx::broadcast(node_hops_glptr, 0, *this->node_team).wait().local();
+    *this->node_load = upcxx::broadcast(node_load_glptr, 0, *this->node_team).wait();
+    node_error_glptr = upcxx::broadcast(node_error_glptr, 0, *this->node_team).wait();
+    this->node_error = node_error_glptr.is_null() ? nullptr : node_error_glptr.local();
+
+    // Pending work of the node is read through shared memory
+    this->node_pending_work.clear();
+    for (int id : this->node_members[this->node_id])
+        this->node_pending_work.push_back(this->pending_work.fetch(id).wait().local());
+    this->node_load->local()->fetch_add(this->item_queue->pending_work(), std::memory_order_relaxed);
+
+    int num_nodes = (int)this->node_members.size();
+    this->remote_load.assign(num_nodes, 0);
+    this->outbox_items.assign(num_nodes, vector<int>());
+    this->outbox_rows.assign(num_nodes, vector<double>());
+    this->next_member.assign(num_nodes, 0);
+
+    if (this->proc_id == 0)
+        printf(">\tHierarchical routing over %d node(s) of %d rank(s), wire codec=%s\n",
+               num_nodes, (int)this->node_members[this->node_id].size(), wire_codec_name(codec).c_str());
+    upcxx::barrier();
+}
+
+//
+// @brief: Gather the latest rows of H into H of proc-0 (collective, after
+// training). The node holding token j owns the freshest copy of H_j
+//
+void Worker::synchronize_H() {
+    if (this->hierarchical == false) {
+        upcxx::barrier();
+        return;
+    }
+
+    this->flush_remote_batches();
+    upcxx::barrier();
+
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+    if (*this->H_node != H_glptr) {
+        upcxx::future<> all_puts = upcxx::make_future();
+        for (int item_idx : this->item_queue->snapshot()) {
+            all_puts = upcxx::when_all(all_puts,
+                upcxx::rput(this->H_node->local() + item_idx * this->num_embeddings,
+                            H_glptr + item_idx * this->num_embeddings,
+                            this->num_embeddings));
+        }
+        all_puts.wait();
+    }
+    upcxx::barrier();
+}
+
+//
+// @brief: Print the bytes sent per SGD update and the update rate of the
+// whole job (collective)
+//
+void Worker::report_transfer_stats(double train_time) {
+    long long int total_updates = upcxx::reduce_all(this->num_updates, upcxx::op_fast_add).wait();
+    long long int total_bytes = upcxx::reduce_all(this->bytes_sent, upcxx::op_fast_add).wait();
+    if (this->proc_id == 0)
+        printf(">\tTransfers: codec=%s, %lld updates, %lld bytes sent, %.2f bytes/update, %.3e updates/s\n",
+               wire_codec_name(this->wire_codec).c_str(), total_updates, total_bytes,
+               (double)total_bytes / max(1LL, total_updates), total_updates / max(train_time, 1e-9));
+}
+
+//
+// @brief: Pop the next token of the local queue and publish the new pending
+// work in the shared segment
+//
+int Worker::pop_item_from_queue() {
+    int token = this->item_queue->pop();
+    long long int cost = this->item_queue->cost(token);
+    this->pending_work->local()->fetch_sub(cost, std::memory_order_relaxed);
+    if (this->node_load->is_null() == false)
+        this->node_load->local()->fetch_sub(cost, std::memory_order_relaxed);
+    return token;
+}
+
+//
+// @brief: Transfer a token and its row of H (raw doubles) to a process of
+// another node, which stores the row in the replica of H of its node
+//
+upcxx::future<> Worker::transfer_item_with_row(int worker_id, int item_index) {
+    double *H_j = this->H_node->local() + item_index * this->num_embeddings;
+    vector<double> row(H_j, H_j + this->num_embeddings);
+    this->bytes_sent += sizeof(int) + row.size() * sizeof(double);
+    this->tracer->record(TraceEvent::SEND, item_index, worker_id);
+    return upcxx::rpc(
+        worker_id,
+        [](upcxx::dist_object<TokenQueue> &item_queue,
+           upcxx::dist_object<upcxx::global_ptr<double>> &H_node,
+           upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &pending_work,
+           upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &node_load,
+           upcxx::dist_object<TokenTracer> &tracer,
+           int item_idx, const vector<double> &row, int sender_id) {
+            copy(row.begin(), row.end(), H_node->local() + item_idx * row.size());
+            tracer->record(TraceEvent::RECEIVE, item_idx, sender_id);
+            push_to_queue(*item_queue, *pending_work, *node_load, item_idx);
+        },
+        item_queue, H_node, pending_work, node_load, tracer, item_index, row, upcxx::rank_me()).then(
+        [this, worker_id, item_index]() {
+            this->tracer->record(TraceEvent::SEND_DONE, item_index, worker_id);
+        });
+}
+
+//
+// @brief: Hierarchical routing of a token: it circulates among the ranks of
+// the node until it has made as many hops as there are ranks on the node,
+// then it joins a batch to the least loaded remote node, unless this node is
+// clearly less loaded than that node, in which case it does another local round.
+// A batch leaves when it is full, when the queue runs empty, or at the latest
+// once this process has served 'max_batch_age' more tokens, so that a token
+// (and its H_j on the other nodes) is never held back for a whole queue
+//
+void Worker::route_item(int item_index) {
+    int num_nodes = (int)this->node_members.size();
+    int node_size = (int)this->node_members[this->node_id].size();
+    this->num_served++;
+    if (this->oldest_batched >= 0 && this->num_served - this->oldest_batched >= this->max_batch_age)
+        this->flush_remote_batches();
+
+    if (num_nodes > 1 && ++this->node_hops[item_index] >= node_size) {
+        this->node_hops[item_index] = 0;
+        if (++this->num_routed % this->load_refresh == 1)
+            this->refresh_remote_load();
+
+        int dest_node = this->get_remote_priority_node_index();
+        if (this->get_node_load() * this->imbalance_ratio >= this->remote_load[dest_node]) {
+            double *H_j = this->H_node->local() + item_index * this->num_embeddings;
+            this->outbox_items[dest_node].push_back(item_index);
+            this->outbox_rows[dest_node].insert(this->outbox_rows[dest_node].end(),
+                                                H_j, H_j + this->num_embeddings);
+            if (this->node_error != nullptr) {
+                double *E_j = this->node_error + item_index * this->num_embeddings;
+                double *row = &this->outbox_rows[dest_node][this->outbox_rows[dest_node].size() - this->num_embeddings];
+                for (int k = 0; k < this->num_embeddings; k++)
+                    row[k] += E_j[k];
+            }
+            this->remote_load[dest_node]++;
+            if (this->oldest_batched < 0)
+                this->oldest_batched = this->num_served;
+
+            if ((int)this->outbox_items[dest_node].size() >= this->batch_size)
+                this->flush_remote_batches();
+            return;
+        }
+    }
+
+    int receiver_id = this->get_local_priority_process_index();
+    this->transfer_item(receiver_id, item_index).wait();
+}
+
+//
+// @brief: Dynamic Load Balancing inside the node: the rank with the least
+// pending work, read from the shared-memory counters without any RPC
+//
+int Worker::get_local_priority_process_index() {
+    const vector<int> &members = this->node_members[this->node_id];
+    long long int min_capac = LLONG_MAX;
+    int min_proc_id = this->proc_id;
+    for (int p = 0; p < (int)members.size(); p++) {
+        long long int capac = this->node_pending_work[p]->load(std::memory_order_relaxed);
+        if (capac < min_capac || (capac == min_capac && members[p] != this->proc_id)) {
+            min_capac = capac;
+            min_proc_id = members[p];
+        }
+    }
+    return min_proc_id;
+}
+
+//
+// @brief: The remote node with the least known load
+//
+int Worker::get_remote_priority_node_index() {
+    int min_node = -1;
+    for (int n = 0; n < (int)this->node_members.size(); n++) {
+        if (n == this->node_id)
+            continue;
+        if (min_node == -1 || this->remote_load[n] < this->remote_load[min_node])
+            min_node = n;
+    }
+    return min_node;
+}
+
+//
+// @brief: The number of tokens queued on this node
+//
+long long int Worker::get_node_load() {
+    return this->node_load->local()->load(std::memory_order_relaxed);
+}
+
+//
+// @brief: Ask the next remote node (round-robin) for its current load
+//
+void Worker::refresh_remote_load() {
+    int num_nodes = (int)this->node_members.size();
+    int target = (this->node_id + 1 + (int)((this->num_routed / this->load_refresh) % (num_nodes - 1))) % num_nodes;
+    this->remote_load[target] = upcxx::rpc(
+        this->node_members[target][0],
+        [](upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &node_load) {
+            return node_load->local()->load(std::memory_order_relaxed);
+        },
+        node_load).wait();
+}
+
+//
+// @brief: Send every pending cross-node batch of (j, H_j) in one RPC per node.
+// With a lossy codec, the part of each row lost by the encoding is stored as
+// the error feedback of this node
+//
+void Worker::flush_remote_batches() {
+    this->oldest_batched = -1;
+    int K = this->num_embeddings;
+    size_t row_bytes = encoded_row_bytes(this->wire_codec, K);
+    vector<double> decoded(K);
+
+    upcxx::future<> all_sends = upcxx::make_future();
+    for (int n = 0; n < (int)this->outbox_items.size(); n++) {
+        if (this->outbox_items[n].empty())
+            continue;
+
+        const vector<int> &items = this->outbox_items[n];
+        vector<uint8_t> payload(items.size() * row_bytes);
+        for (int p = 0; p < (int)items.size(); p++) {
+            const double *row = &this->outbox_rows[n][p * K];
+            encode_row(row, K, this->wire_codec, &payload[p * row_bytes]);
+            if (this->node_error != nullptr) {
+                decode_row(&payload[p * row_bytes], K, this->wire_codec, decoded.data());
+                double *E_j = this->node_error + items[p] * K;
+                for (int k = 0; k < K; k++)
+                    E_j[k] = row[k] - decoded[k];
+            }
+        }
+        this->bytes_sent += items.size() * sizeof(int) + payload.size();
+
+        const vector<int> &members = this->node_members[n];
+        int receiver_id = members[this->next_member[n]++ % members.size()];
+        for (int item_idx : items)
+            this->tracer->record(TraceEvent::SEND, item_idx, receiver_id);
+        all_sends = upcxx::when_all(all_sends, upcxx::rpc(
+            receiver_id,
+            [](upcxx::dist_object<TokenQueue> &item_queue,
+               upcxx::dist_object<upcxx::global_ptr<double>> &H_node,
+               upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &pending_work,
+               upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> &node_load,
+               upcxx::dist_object<TokenTracer> &tracer,
+               const vector<int> &items, const vector<uint8_t> &payload, WireCodec codec, int K, int sender_id) {
+                size_t row_bytes = encoded_row_bytes(codec, K);
+                double *H_ptr = H_node->local();
+                for (int p = 0; p < (int)items.size(); p++) {
+                    decode_row(&payload[p * row_bytes], K, codec, H_ptr + items[p] * K);
+                    tracer->record(TraceEvent::RECEIVE, items[p], sender_id);
+                    push_to_queue(*item_queue, *pending_work, *node_load, items[p]);
+                }
+            },
+            this->item_queue, this->H_node, this->pending_work, this->node_load, this->tracer,
+            items, payload, this->wire_codec, K, upcxx::rank_me()).then(
+            [this, receiver_id, items]() {
+                for (int item_idx : items)
+                    this->tracer->record(TraceEvent::SEND_DONE, item_idx, receiver_id);
+            }));
+
+        this->outbox_items[n].clear();
+        this->outbox_rows[n].clear();
+    }
+    all_sends.wait();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Popularity-aware scheduling functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Split the items rated more than 'hot_factor' times the average
+// into sub-tokens (at most one per process), each with its own copy of H_j,
+// and order every local queue by the local work of the tokens.
+// Collective, before setup_routing and before any token is queued
+//
+void Worker::setup_scheduling(const vector<int> &item_popularity, double hot_factor) {
+    assert((int)item_popularity.size() == this->num_items);
+    upcxx::barrier();
+
+    long long int total_ratings = 0;
+    for (int pop : item_popularity)
+        total_ratings += pop;
+    double threshold = hot_factor * total_ratings / this->num_items;
+
+    for (int j = 0; j < this->num_items; j++) {
+        if (hot_factor <= 0.0 || item_popularity[j] <= threshold)
+            continue;
+        int split = min(upcxx::rank_n(), (int)ceil(item_popularity[j] / threshold));
+        if (split <= 1)
+            continue;
+
+        this->item_split[j] = split;
+        this->first_subtoken[j] = this->num_tokens;
+        this->hot_index[j] = (int)this->hot_items.size();
+        this->hot_items.push_back(j);
+        for (int slot = 1; slot < split; slot++) {
+            this->token_item.push_back(j);
+            this->token_slot.push_back(slot);
+            this->num_tokens++;
+        }
+    }
+
+    this->update_token_work();
+
+    // Replicate the rows of the hot items in H of proc-0
+    if (this->proc_id == 0 && this->num_tokens > this->num_items) {
+        int K = this->num_embeddings;
+        upcxx::global_ptr<double> old_H = *this->H;
+        upcxx::global_ptr<double> new_H = upcxx::new_array<double>(this->num_tokens * K);
+        memcpy(new_H.local(), old_H.local(), this->num_items * K * sizeof(double));
+        for (int token = this->num_items; token < this->num_tokens; token++)
+            memcpy(new_H.local() + token * K, old_H.local() + this->token_item[token] * K, K * sizeof(double));
+        upcxx::delete_array(old_H);
+        *this->H = new_H;
+    }
+
+    if (this->proc_id == 0)
+        printf(">\tPopularity-aware scheduling: %d hot item(s), %d token(s) for %d item(s)\n",
+               (int)this->hot_items.size(), this->num_tokens, this->num_items);
+    upcxx::barrier();
+}
+
+//
+// @brief: Estimated work of each token here: the local ratings it serves.
+// Queued tokens take the new costs, and the pending work published for the
+// routing follows (ratings still arriving count once finish_loading rebuilds
+// the local ratings)
+//
+void Worker::update_token_work() {
+    vector<int> token_work(this->fifo_queues ? 0 : this->num_tokens, 0);
+    for (int i = 0; i < (int)this->local_ratings.size() && this->fifo_queues == false; i++) {
+        for (auto &rating : this->local_ratings[i]) {
+            int j = rating.first;
+            int slot = this->user_index->at(i) % this->item_split[j];
+            token_work[(slot == 0) ? j : this->first_subtoken[j] + slot - 1]++;
+        }
+    }
+    long long int change = this->item_queue->set_token_work(token_work);
+    this->pending_work->local()->fetch_add(change, std::memory_order_relaxed);
+    if (this->node_load->is_null() == false)
+        this->node_load->local()->fetch_add(change, std::memory_order_relaxed);
+}
+
+//
+// @brief: Replace the rows of the sub-tokens of every hot item by their
+// average (collective). Every token is queued somewhere once the pending
+// cross-node batches are delivered
+//
+void Worker::reconcile_hot_items() {
+    if (this->hot_items.empty())
+        return;
+
+    if (this->hierarchical)
+        this->flush_remote_batches();
+    upcxx::barrier();
+
+    int K = this->num_embeddings;
+    double *H_ptr = this->H_node->local();
+    vector<int> tokens = this->item_queue->snapshot();
+    vector<double> partial(this->hot_items.size() * K, 0.0);
+    vector<double> total(this->hot_items.size() * K, 0.0);
+    for (int token : tokens) {
+        int h = this->hot_index[this->token_item[token]];
+        if (h < 0)
+            continue;
+        for (int k = 0; k < K; k++)
+            partial[h * K + k] += H_ptr[token * K + k];
+    }
+    upcxx::reduce_all(partial.data(), total.data(), total.size(), upcxx::op_fast_add).wait();
+
+    for (int token : tokens) {
+        int j = this->token_item[token];
+        int h = this->hot_index[j];
+        if (h < 0)
+            continue;
+        for (int k = 0; k < K; k++)
+            H_ptr[token * K + k] = total[h * K + k] / this->item_split[j];
+    }
+    upcxx::barrier();
+}
+
+//
+// @brief: End of training (collective): time the wait of this process at
+// the barrier for the processes still running their last epochs
+//
+void Worker::wait_for_stragglers() {
+    auto wait_start = std::chrono::steady_clock::now();
+    upcxx::barrier();
+    this->straggler_wait = std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+}
+
+//
+// @brief: Print the time each process spent with an empty queue and
+// waiting for the others at the end of training (collective)
+//
+void Worker::report_idle_time() {
+    upcxx::dist_object<pair<double, double>> idle(make_pair(this->idle_time, this->straggler_wait));
+    if (this->proc_id == 0) {
+        double max_idle = 0.0, sum_idle = 0.0;
+        for (int id = 0; id < upcxx::rank_n(); id++) {
+            pair<double, double> wait = idle.fetch(id).wait();
+            double t = wait.first + wait.second;
+            printf(">\tproc-id=%02d: idle %.3fs (empty queue %.3fs, end of training %.3fs)\n",
+                   id, t, wait.first, wait.second);
+            max_idle = max(max_idle, t);
+            sum_idle += t;
+        }
+        printf(">\tIdle time: mean %.3fs, max %.3fs\n", sum_idle / upcxx::rank_n(), max_idle);
+    }
+    upcxx::barrier();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory placement functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Print the memory policy, the pages granted on proc-0, and the
+// data-TLB load misses per SGD update of the whole job (collective);
+// 'tlb_misses' is -1 on the processes that cannot count them
+//
+void Worker::report_memory_stats(double train_time, long long int tlb_misses) {
+    long long int total_updates = upcxx::reduce_all(this->num_updates, upcxx::op_fast_add).wait();
+    long long int total_misses = upcxx::reduce_all(max(0LL, tlb_misses), upcxx::op_fast_add).wait();
+    long long int min_misses = upcxx::reduce_all(tlb_misses, upcxx::op_fast_min).wait();
+    if (this->proc_id == 0) {
+        printf(">\tMemory: %s; %s\n", memory_policy_name(this->memory_policy).c_str(), this->memory_granted.c_str());
+        if (min_misses < 0)
+            printf(">\tdTLB load misses: not available (perf_event_open refused)\n");
+        else if (total_updates > 0)
+            printf(">\tdTLB load misses = %lld, %.3f per SGD update, %.3e updates/s\n", total_misses,
+                   (double)total_misses / total_updates, total_updates / max(train_time, 1e-9));
+        else
+            printf(">\tdTLB load misses = %lld\n", total_misses);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pipelined loading functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Rebuild the sparse view of the local rows once the last ratings
+// of the loader have landed in A (SGD reads A directly and picks up the
+// ratings as they arrive; ALS, CCD++ and the train RMSE need them all), and
+// the work of the tokens, which the scheduling took from the rows resident
+// at setup
+//
+void Worker::finish_loading() {
+    this->build_local_ratings();
+    this->update_token_work();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Token-flow tracing functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Start tracing 1 in 'sample_every' tokens into a ring of
+// 'capacity' records per process (collective). The clocks of all processes
+// start at the same barrier, so that their timelines line up
+//
+void Worker::setup_tracing(size_t capacity, int sample_every) {
+    *this->tracer = TokenTracer(capacity, sample_every);
+    this->tracing_idle = false;
+    upcxx::barrier();
+    this->tracer->start();
+}
+
+//
+// @brief: Gather the trace records of every process into proc-0 and write
+// them as a Chrome trace / Perfetto JSON timeline (collective)
+//
+void Worker::export_trace(const string &file) {
+    if (this->tracing_idle) {
+        this->tracer->record(TraceEvent::IDLE_END, -1);
+        this->tracing_idle = false;
+    }
+    upcxx::dist_object<vector<TraceRecord>> records(this->tracer->snapshot());
+    long long int dropped = upcxx::reduce_all((long long int)this->tracer->get_num_dropped(), upcxx::op_fast_add).wait();
+    if (this->proc_id == 0) {
+        vector<vector<TraceRecord>> rank_records(upcxx::rank_n());
+        long long int total = 0;
+        for (int id = 0; id < upcxx::rank_n(); id++) {
+            rank_records[id] = records.fetch(id).wait();
+            total += rank_records[id].size();
+        }
+        if (write_chrome_trace(file, rank_records, this->token_item))
+            printf(">\tTrace: %lld events (%lld dropped by the rings) written to %s\n", total, dropped, file.c_str());
+        else
+            fprintf(stderr, "Cannot write %s\n", file.c_str());
+    }
+    upcxx::barrier();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental training functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Start from a previous model (collective): W_model and H_model hold
+// the rows of its num_model_users users and num_model_items items; the rows
+// of users and items added since then start at zero. The model does not
+// keep the update counts, so update_step restarts at 0 and the learning
+// rate at alpha on purpose: a warm restart, which lets the touched rows move
+// to the delta within a few passes (the rows not touched stay frozen)
+//
+void Worker::load_factors(const vector<double> &W_model, const vector<double> &H_model,
+                          int num_model_users, int num_model_items) {
+    int K = this->num_embeddings;
+    assert((int)W_model.size() == num_model_users * K && (int)H_model.size() == num_model_items * K);
+
+    double *w_ptr = this->W->local();
+    for (int i = 0; i < (int)this->user_index->size(); i++) {
+        int usr_idx = this->user_index->at(i);
+        if (usr_idx < num_model_users)
+            copy(W_model.begin() + usr_idx * K, W_model.begin() + (usr_idx + 1) * K, w_ptr + i * K);
+        else
+            fill(w_ptr + i * K, w_ptr + (i + 1) * K, 0.0);
+    }
+
+    if (this->proc_id == 0) {
+        double *h_ptr = this->H->local();
+        copy(H_model.begin(), H_model.end(), h_ptr);
+        fill(h_ptr + num_model_items * K, h_ptr + this->num_items * K, 0.0);
+    }
+    upcxx::barrier();
+}
+
+//
+// @brief: Fold in the users and items added since the previous model by
+// least squares against the fixed opposite factors (collective): the new
+// items against the known users, then the new users against all items, then
+// the new items again so that ratings between new users and new items count
+//
+void Worker::fold_in(int num_model_users, int num_model_items) {
+    if (this->als_ready == false) {
+        this->build_item_ratings();
+        this->als_ready = true;
+    }
+    int K = this->num_embeddings;
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+
+    for (int round = 0; round < 2; round++) {
+        // New items with W fixed
+        this->fetch_W_to_cache();
+        this->H_cache.assign(this->num_items * K, 0.0);
+        upcxx::future<> all_puts = upcxx::make_future();
+        for (int slot = 0; slot < (int)this->owned_ratings.size(); slot++) {
+            int item_idx = slot * upcxx::rank_n() + upcxx::rank_me();
+            if (item_idx < num_model_items)
+                continue;
+
+            vector<pair<int, double>> ratings;
+            for (auto &rating : this->owned_ratings[slot])
+                if (round > 0 || rating.first < num_model_users)
+                    ratings.push_back(rating);
+
+            double *H_j = &this->H_cache[item_idx * K];
+            this->solve_least_squares(ratings, this->W_cache, H_j);
+            all_puts = upcxx::when_all(all_puts, upcxx::rput(H_j, H_glptr + item_idx * K, K));
+        }
+        all_puts.wait();
+        upcxx::barrier();
+
+        if (round > 0)
+            break;
+
+        // New users with H fixed
+        this->fetch_H_to_cache();
+        double *W_ptr = this->W->local();
+        for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+            if (this->user_index->at(i) >= num_model_users)
+                this->solve_least_squares(this->local_ratings[i], this->H_cache, W_ptr + i * K);
+        }
+        upcxx::barrier();
+    }
+    return;
+}
+
+//
+// @brief: Only the users with trainable_users[usr_idx] != 0 have their row
+// of W updated by SGD; the rows of the other users stay fixed
+//
+void Worker::freeze_users(const vector<char> &trainable_users) {
+    assert((int)trainable_users.size() == this->num_users);
+    this->frozen_user.assign(this->user_index->size(), 0);
+    for (int i = 0; i < (int)this->user_index->size(); i++)
+        this->frozen_user[i] = (trainable_users[this->user_index->at(i)] == 0);
+    return;
+}
+
+//
+// @brief: All rows of W by global user index, called by proc-0 only
+//
+vector<double> Worker::gather_W() {
+    this->fetch_W_to_cache();
+    return this->W_cache;
+}
+
+//
+// @brief: The num_items rows of H of proc-0, called by proc-0 only after
+// synchronize_H()
+//
+vector<double> Worker::gather_H() {
+    assert(this->proc_id == 0);
+    double *h_ptr = this->H->local();
+    return vector<double>(h_ptr, h_ptr + this->num_items * this->num_embeddings);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ALS / CCD++ Model functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: Perform one sweep of Alternating Least Squares: solve every local
+// row of W with H fixed, then every owned row of H with W fixed.
+// Item j is owned by process (j % rank_n()). Both solvers minimize
+// sum (A_ij - W_i * H_j)^2 + lambda * (|Omega_i| ||W_i||^2 + |Omega_j| ||H_j||^2)
+//
+void Worker::update_als(int epoch_idx) {
+    if (this->als_ready == false) {
+        this->build_item_ratings();
+        this->als_ready = true;
+    }
+
+    // Solve W with H fixed
+    this->fetch_H_to_cache();
+    double *W_ptr = this->W->local();
+    for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+        this->solve_least_squares(this->local_ratings[i], this->H_cache,
+                                  W_ptr + i * this->num_embeddings);
+    }
+    upcxx::barrier();
+
+    // Solve owned rows of H with W fixed
+    this->fetch_W_to_cache();
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+    upcxx::future<> all_puts = upcxx::make_future();
+    for (int slot = 0; slot < (int)this->owned_ratings.size(); slot++) {
+        int item_idx = slot * upcxx::rank_n() + upcxx::rank_me();
+        double *H_j = &this->H_cache[item_idx * this->num_embeddings];
+
+        this->solve_least_squares(this->owned_ratings[slot], this->W_cache, H_j);
+        all_puts = upcxx::when_all(all_puts,
+                                   upcxx::rput(H_j, H_glptr + (item_idx * this->num_embeddings),
+                                               this->num_embeddings));
+    }
+    all_puts.wait();
+    upcxx::barrier();
+
+    return;
+}
+
+//
+// @brief: Perform one sweep of CCD++: for each latent feature t, refit the
+// rank-one pair (W[:,t], H[:,t]) against the residual with
+// 'num_inner_iters' alternating coordinate updates
+//
+void Worker::update_ccd(int epoch_idx, int num_inner_iters) {
+    int K = this->num_embeddings;
+    double *W_ptr = this->W->local();
+
+    // Build the residual R_ij = A_ij - W_i * H_j once, then maintain it
+    if (this->ccd_ready == false) {
+        this->fetch_H_to_cache();
+        this->residual.resize(this->local_ratings.size());
+        for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+            this->residual[i].resize(this->local_ratings[i].size());
+            for (int p = 0; p < (int)this->local_ratings[i].size(); p++) {
+                int j = this->local_ratings[i][p].first;
+                double dot = 0.0;
+                for (int k = 0; k < K; k++)
+                    dot += W_ptr[i * K + k] * this->H_cache[j * K + k];
+                this->residual[i][p] = this->local_ratings[i][p].second - dot;
+            }
+        }
+        this->ccd_ready = true;
+    }
+
+    vector<double> partial(3 * this->num_items);
+    vector<double> total(3 * this->num_items);
+
+    for (int t = 0; t < K; t++) {
+        // Add the current rank-one term back into the residual
+        for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+            for (int p = 0; p < (int)this->local_ratings[i].size(); p++) {
+                int j = this->local_ratings[i][p].first;
+                this->residual[i][p] += W_ptr[i * K + t] * this->H_cache[j * K + t];
+            }
+        }
+
+        for (int s = 0; s < num_inner_iters; s++) {
+            // Coordinate update of W[:,t]: purely local
+            for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+                if (this->local_ratings[i].empty())
+                    continue;
+                double num = 0.0;
+                double den = this->_lambda_ * this->local_ratings[i].size();
+                for (int p = 0; p < (int)this->local_ratings[i].size(); p++) {
+                    double h_jt = this->H_cache[this->local_ratings[i][p].first * K + t];
+                    num += this->residual[i][p] * h_jt;
+                    den += h_jt * h_jt;
+                }
+                W_ptr[i * K + t] = num / den;
+            }
+
+            // Coordinate update of H[:,t]: reduce (numerator, denominator, count) of all items
+            fill(partial.begin(), partial.end(), 0.0);
+            for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+                double w_it = W_ptr[i * K + t];
+                for (int p = 0; p < (int)this->local_ratings[i].size(); p++) {
+                    int j = this->local_ratings[i][p].first;
+                    partial[3 * j] += this->residual[i][p] * w_it;
+                    partial[3 * j + 1] += w_it * w_it;
+                    partial[3 * j + 2] += 1.0;
+                }
+            }
+            upcxx::reduce_all(partial.data(), total.data(), partial.size(), upcxx::op_fast_add).wait();
+
+            for (int j = 0; j < this->num_items; j++) {
+                if (total[3 * j + 2] == 0.0)
+                    continue;
+                this->H_cache[j * K + t] = total[3 * j] / (total[3 * j + 1] + this->_lambda_ * total[3 * j + 2]);
+            }
+        }
+
+        // Remove the refitted rank-one term from the residual
+        for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+            for (int p = 0; p < (int)this->local_ratings[i].size(); p++) {
+                int j = this->local_ratings[i][p].first;
+                this->residual[i][p] -= W_ptr[i * K + t] * this->H_cache[j * K + t];
+            }
+        }
+    }
+
+    // Every process holds the same H_cache: proc-0 publishes it to the global H
+    if (this->proc_id == 0) {
+        upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+        upcxx::rput(this->H_cache.data(), H_glptr, this->H_cache.size()).wait();
+    }
+    upcxx::barrier();
+
+    return;
+}
+
+//
+// @brief: Compute the RMSE over all observed ratings of all processes
+// (collective: must be called by every process)
+//
+double Worker::compute_train_rmse() {
+    this->fetch_H_to_cache();
+    double *W_ptr = this->W->local();
+
+    double local_sse = 0.0;
+    double local_cnt = 0.0;
+    for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+        for (auto &rating : this->local_ratings[i]) {
+            double dot = 0.0;
+            for (int k = 0; k < this->num_embeddings; k++)
+                dot += W_ptr[i * this->num_embeddings + k] * this->H_cache[rating.first * this->num_embeddings + k];
+            local_sse += (dot - rating.second) * (dot - rating.second);
+            local_cnt += 1.0;
+        }
+    }
+
+    double sse = upcxx::reduce_all(local_sse, upcxx::op_fast_add).wait();
+    double cnt = upcxx::reduce_all(local_cnt, upcxx::op_fast_add).wait();
+    return (cnt > 0.0) ? sqrt(sse / cnt) : 0.0;
+}
+
+//
+// @brief: Collect the non-zero entries of the local rows of A
+//
+void Worker::build_local_ratings() {
+    this->local_ratings.assign(this->user_index->size(), vector<pair<int, double>>());
+    for (int i = 0; i < (int)this->user_index->size(); i++) {
+        const double *A_i = &this->A[(size_t)i * this->num_items];
+        for (int j = 0; j < this->num_items; j++) {
+            if (A_i[j] != 0.0)
+                this->local_ratings[i].push_back(make_pair(j, A_i[j]));
+        }
+    }
+    return;
+}
+
+//
+// @brief: Scatter every local rating to the owner of its item, so that each
+// process holds the full columns of A for the rows of H it solves
+//
+void Worker::build_item_ratings() {
+    int num_proc = upcxx::rank_n();
+    vector<vector<Rating>> outbox(num_proc);
+    for (int i = 0; i < (int)this->local_ratings.size(); i++) {
+        for (auto &rating : this->local_ratings[i]) {
+            outbox[rating.first % num_proc].push_back(
+                Rating{this->user_index->at(i), rating.first, rating.second});
+        }
+    }
+
+    upcxx::future<> all_sends = upcxx::make_future();
+    for (int id = 0; id < num_proc; id++) {
+        if (outbox[id].empty())
+            continue;
+        all_sends = upcxx::when_all(all_sends,
+            upcxx::rpc(id,
+                       [](upcxx::dist_object<vector<Rating>> &item_ratings, const vector<Rating> &batch) {
+                           item_ratings->insert(item_ratings->end(), batch.begin(), batch.end());
+                       },
+                       this->item_ratings, outbox[id]));
+    }
+    all_sends.wait();
+    upcxx::barrier();
+
+    int num_owned = (this->num_items - upcxx::rank_me() + num_proc - 1) / num_proc;
+    this->owned_ratings.assign(max(0, num_owned), vector<pair<int, double>>());
+    for (auto &rating : *this->item_ratings)
+        this->owned_ratings[rating.item_idx / num_proc].push_back(make_pair(rating.user_idx, rating.value));
+    this->item_ratings->clear();
+    this->item_ratings->shrink_to_fit();
+
+    return;
+}
+
+//
+// @brief: Copy the whole matrix H from proc-0 into the local cache
+//
+void Worker::fetch_H_to_cache() {
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+    this->H_cache.resize(this->num_items * this->num_embeddings);
+    upcxx::rget(H_glptr, this->H_cache.data(), this->H_cache.size()).wait();
+    return;
+}
+
+//
+// @brief: Gather the rows of W of every process into the local cache,
+// indexed by global user index
+//
+void Worker::fetch_W_to_cache() {
+    this->W_cache.assign(this->num_users * this->num_embeddings, 0.0);
+    for (int worker_id = 0; worker_id < upcxx::rank_n(); worker_id++) {
+        vector<int> remote_user_index = this->user_index.fetch(worker_id).wait();
+        upcxx::global_ptr<double> W_glptr = this->W.fetch(worker_id).wait();
+
+        vector<double> block(remote_user_index.size() * this->num_embeddings);
+        upcxx::rget(W_glptr, block.data(), block.size()).wait();
+
+        for (int i = 0; i < (int)remote_user_index.size(); i++) {
+            copy(block.begin() + i * this->num_embeddings,
+                 block.begin() + (i + 1) * this->num_embeddings,
+                 this->W_cache.begin() + remote_user_index[i] * this->num_embeddings);
+        }
+    }
+    return;
+}
+
+//
+// @brief: Solve the regularized least squares problem of one row:
+// (lambda * |ratings| * I + sum F_j F_j^T) x = sum r_j F_j, where F_j is the
+// j-th row of 'factors'. Rows without any rating are left untouched
+//
+void Worker::solve_least_squares(const vector<pair<int, double>> &ratings,
+                                 const vector<double> &factors, double *out) {
+    if (ratings.empty())
+        return;
+
+    int K = this->num_embeddings;
+    vector<double> G(K * K, 0.0);
+    vector<double> b(K, 0.0);
+
+    // Rank-one accumulation of the upper triangle of the Gram matrix
+    for (auto &rating : ratings) {
+        const double *F_j = &factors[rating.first * K];
+        for (int a = 0; a < K; a++) {
+            double f_a = F_j[a];
+            b[a] += rating.second * f_a;
+            double *G_a = &G[a * K];
+            for (int c = a; c < K; c++)
+                G_a[c] += f_a * F_j[c];
+        }
+    }
+    for (int a = 0; a < K; a++) {
+        G[a * K + a] += this->_lambda_ * ratings.size();
+        for (int c = a + 1; c < K; c++)
+            G[c * K + a] = G[a * K + c];
+    }
+
+    this->solve_spd_system(G, b, K);
+    copy(b.begin(), b.end(), out);
+    return;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Private factor initialization functions
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// @brief: The contiguous range [first_item, last_item) of rows of H
+// initialized by this process
+//
+void Worker::get_item_shard(int &first_item, int &last_item) {
+    first_item = (int)((long long int)this->num_items * upcxx::rank_me() / upcxx::rank_n());
+    last_item = (int)((long long int)this->num_items * (upcxx::rank_me() + 1) / upcxx::rank_n());
+    return;
+}
+
+//
+// @brief: Write the rows [first_item, last_item) of H into H of proc-0
+//
+void Worker::put_H_shard(const vector<double> &rows, int first_item, int last_item) {
+    if (last_item <= first_item)
+        return;
+    upcxx::global_ptr<double> H_glptr = this->H.fetch(0).wait();
+    upcxx::rput(rows.data(), H_glptr + first_item * this->num_embeddings,
+                (last_item - first_item) * this->num_embeddings).wait();
+    return;
+}
+
+//
+// @brief: Orthonormalize the columns of the matrix whose rows are spread
+// over the processes (Cholesky QR): Y <- Y R^-1 with Y^T Y = R^T R (collective)
+//
+void Worker::orthonormalize_rows(vector<double> &Y, int num_cols) {
+    int l = num_cols;
+    int n_local = (int)(Y.size() / l);
+
+    vector<double> partial(l * l, 0.0);
+    vector<double> G(l * l, 0.0);
+    for (int i = 0; i < n_local; i++)
+        for (int a = 0; a < l; a++)
+            for (int c = a; c < l; c++)
+                partial[a * l + c] += Y[i * l + a] * Y[i * l + c];
+    upcxx::reduce_all(partial.data(), G.data(), G.size(), upcxx::op_fast_add).wait();
+
+    double trace = 0.0;
+    for (int a = 0; a < l; a++) {
+        trace += G[a * l + a];
+        for (int c = a + 1; c < l; c++)
+            G[c * l + a] = G[a * l + c];
+    }
+    for (int a = 0; a < l; a++)
+        G[a * l + a] += 1e-12 * trace / l;
+    this->cholesky_factorize(G, l);
+
+    // Row y of Y becomes x with L x = y (R = L^T)
+    for (int i = 0; i < n_local; i++) {
+        double *y = &Y[i * l];
+        for (int a = 0; a < l; a++) {
+            for (int k = 0; k < a; k++)
+                y[a] -= G[a * l + k] * y[k];
+            y[a] /= G[a * l + a];
+        }
+    }
+    return;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Math: Linear algebra functions
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -373,6 +1706,121 @@ double Worker::vec_norm_2(vector<double> vec){
     return sqrt(ans);
 }
 
+//
+// @brief: Solve G x = b in place (x is returned in b) for a symmetric
+// positive definite n x n matrix G using Cholesky factorization
+//
+void Worker::solve_spd_system(vector<double> &G, vector<double> &b, int n) {
+    assert((int)G.size() == n * n && (int)b.size() == n);
+
+    // Factorize G = L L^T, L is stored in the lower triangle of G
+    this->cholesky_factorize(G, n);
+
+    // Forward substitution: L y = b
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < i; k++)
+            b[i] -= G[i * n + k] * b[k];
+        b[i] /= G[i * n + i];
+    }
+
+    // Backward substitution: L^T x = y
+    for (int i = n - 1; i >= 0; i--) {
+        for (int k = i + 1; k < n; k++)
+            b[i] -= G[k * n + i] * b[k];
+        b[i] /= G[i * n + i];
+    }
+    return;
+}
+
+//
+// @brief: Cholesky factorization G = L L^T of a symmetric positive definite
+// n x n matrix; L overwrites the lower triangle of G
+//
+void Worker::cholesky_factorize(vector<double> &G, int n) {
+    for (int j = 0; j < n; j++) {
+        double diag = G[j * n + j];
+        for (int k = 0; k < j; k++)
+            diag -= G[j * n + k] * G[j * n + k];
+        diag = sqrt(max(diag, 1e-12));
+        G[j * n + j] = diag;
+
+        for (int i = j + 1; i < n; i++) {
+            double v = G[i * n + j];
+            for (int k = 0; k < j; k++)
+                v -= G[i * n + k] * G[j * n + k];
+            G[i * n + j] = v / diag;
+        }
+    }
+    return;
+}
+
+//
+// @brief: Eigen-decomposition S = V diag(eigvals) V^T of a symmetric n x n
+// matrix with the cyclic Jacobi method; eigenvalues are sorted in decreasing
+// order and column k of V (V[c * n + k]) is the k-th eigenvector
+//
+void Worker::symmetric_eigen(vector<double> S, int n, vector<double> &eigvals, vector<double> &V) {
+    vector<double> Q(n * n, 0.0);
+    for (int a = 0; a < n; a++)
+        Q[a * n + a] = 1.0;
+
+    double norm = 0.0;
+    for (double v : S)
+        norm += v * v;
+
+    for (int sweep = 0; sweep < 50; sweep++) {
+        double off = 0.0;
+        for (int p = 0; p < n; p++)
+            for (int q = p + 1; q < n; q++)
+                off += S[p * n + q] * S[p * n + q];
+        if (off <= 1e-24 * norm)
+            break;
+
+        for (int p = 0; p < n; p++) {
+            for (int q = p + 1; q < n; q++) {
+                double s_pq = S[p * n + q];
+                if (fabs(s_pq) < 1e-300)
+                    continue;
+
+                double theta = (S[q * n + q] - S[p * n + p]) / (2.0 * s_pq);
+                double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < n; k++) {
+                    double s_kp = S[k * n + p], s_kq = S[k * n + q];
+                    S[k * n + p] = c * s_kp - s * s_kq;
+                    S[k * n + q] = s * s_kp + c * s_kq;
+                }
+                for (int k = 0; k < n; k++) {
+                    double s_pk = S[p * n + k], s_qk = S[q * n + k];
+                    S[p * n + k] = c * s_pk - s * s_qk;
+                    S[q * n + k] = s * s_pk + c * s_qk;
+                }
+                for (int k = 0; k < n; k++) {
+                    double q_kp = Q[k * n + p], q_kq = Q[k * n + q];
+                    Q[k * n + p] = c * q_kp - s * q_kq;
+                    Q[k * n + q] = s * q_kp + c * q_kq;
+                }
+            }
+        }
+    }
+
+    vector<int> order(n);
+    for (int a = 0; a < n; a++)
+        order[a] = a;
+    sort(order.begin(), order.end(), [&S, n](int a, int b) { return S[a * n + a] > S[b * n + b]; });
+
+    eigvals.resize(n);
+    V.assign(n * n, 0.0);
+    for (int k = 0; k < n; k++) {
+        eigvals[k] = S[order[k] * n + order[k]];
+        for (int c = 0; c < n; c++)
+            V[c * n + k] = Q[c * n + order[k]];
+    }
+    return;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Debugging functions
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -385,10 +1833,10 @@ void Worker::print_debug_matrix(bool print_A = false, bool print_W = false, bool
 
     if (print_A == true) {
         printf(" ** Segment of A ** \n");
-        for (int i = 0; i < this->A.size(); i++) {
+        for (int i = 0; i < (int)this->user_index->size(); i++) {
             printf("user-id = %02d\t", this->user_index->at(i));
-            for (int j = 0; j < this->A.at(i).size(); j++)
-                printf("%.0f  ", this->A.at(i).at(j));
+            for (int j = 0; j < this->num_items; j++)
+                printf("%.0f  ", this->A[(size_t)i * this->num_items + j]);
             printf("\n");
         }
     }
@@ -433,19 +1881,11 @@ void Worker::print_debug_matrix(bool print_A = false, bool print_W = false, bool
 // @brief: Print the content int the processing queue
 //
 void Worker::print_debug_queue() {
-    vector<int> back_up_queue;
-
     printf("The queue of proc-id=%d:\t", this->proc_id);
-    while (this->item_queue->empty() == false) {
-        printf("%02d  ", this->item_queue->front());
-        back_up_queue.push_back(this->item_queue->front());
-        this->item_queue->pop();
-    }
+    for (int token : this->item_queue->snapshot())
+        printf("%02d  ", token);
     printf("\n");
 
-    for (auto v : back_up_queue)
-        this->item_queue->push(v);
-
     return;
 }
 
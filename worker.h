@@ -5,7 +5,7 @@
 // @project : NOMAD algorithm for matrix completion with UPCXX 
 // @licensed: N/A
 // @created : 03/07/2020
-// @modified: 09/07/2020
+// @modified: 19/10/2026
 // 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -21,12 +21,31 @@
 #include <random>
 #include <queue>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <climits>
 #include <cmath>
 #include <cstring>
 #include <cassert>
 #include <upcxx/upcxx.hpp>
+#include "data_io.h"
+#include "codec.h"
+#include "token_queue.h"
+#include "rng.h"
+#include "memory_policy.h"
+#include "tracer.h"
 using namespace std;
 
+//
+// @brief: Initialization of W and H:
+//  + UNIFORM:   counter-based uniform random values in [0, 1/sqrt(K))
+//  + ITEM_MEAN: W_i * H_j starts at sqrt(mean of user i * mean of item j)
+//  + SVD:       randomized truncated SVD of the (zero-filled) rating matrix
+//
+enum class InitMode { UNIFORM, ITEM_MEAN, SVD };
+
 class Worker {
 
 public: 
@@ -40,7 +59,8 @@ public:
     Worker(int proc_id, int num_users,                      // User-defined constructor
            int num_items,int num_embeddings,
            double _alpha_, double _beta_, double _lambda_,
-           vector<int>user_index, vector<vector<double>>A);
+           vector<int> &&user_index, PolicyArray<double> &&A,
+           const MemoryPolicy &policy = MemoryPolicy());
 
     Worker(const Worker& old)               = default;
     Worker& operator=(const Worker& old)    = default;
@@ -51,12 +71,68 @@ public:
     ///////////////////////////////////////////////////////
     // SGD-NOMAD Model functions
     ///////////////////////////////////////////////////////
+    void                    initialize_factors(InitMode mode, uint64_t seed);
     void                    initialize_W_uniform_random();
     void                    initialize_H_uniform_random();
+    void                    initialize_item_mean();
+    void                    initialize_truncated_svd();
     void                    add_item_idx_to_queue(int item_idx);
     void                    update(int epoch_idx);
+    void                    update_lockstep(int epoch_idx);
+    void                    set_reproducible(uint64_t seed);
+    void                    set_fifo_queues();
     vector<vector<double>>  compute_approximate_A();
 
+    ///////////////////////////////////////////////////////
+    // Token routing functions
+    ///////////////////////////////////////////////////////
+    void                    setup_routing(bool hierarchical, WireCodec codec);
+    void                    synchronize_H();
+    void                    report_transfer_stats(double train_time);
+
+    ///////////////////////////////////////////////////////
+    // Popularity-aware scheduling functions
+    ///////////////////////////////////////////////////////
+    void                    setup_scheduling(const vector<int> &item_popularity, double hot_factor);
+    int                     get_num_tokens() const { return this->num_tokens; }
+    void                    reconcile_hot_items();
+    void                    wait_for_stragglers();
+    void                    report_idle_time();
+
+    ///////////////////////////////////////////////////////
+    // Memory placement functions
+    ///////////////////////////////////////////////////////
+    void                    report_memory_stats(double train_time, long long int tlb_misses);
+
+    ///////////////////////////////////////////////////////
+    // Pipelined loading functions
+    ///////////////////////////////////////////////////////
+    void                    finish_loading();
+
+    ///////////////////////////////////////////////////////
+    // Token-flow tracing functions
+    ///////////////////////////////////////////////////////
+    void                    setup_tracing(size_t capacity, int sample_every);
+    void                    export_trace(const string &file);
+
+    ///////////////////////////////////////////////////////
+    // Incremental training functions
+    ///////////////////////////////////////////////////////
+    void                    load_factors(const vector<double> &W_model, const vector<double> &H_model,
+                                         int num_model_users, int num_model_items);
+    void                    fold_in(int num_model_users, int num_model_items);
+    void                    freeze_users(const vector<char> &trainable_users);
+    int                     get_token_item(int token) const { return this->token_item[token]; }
+    vector<double>          gather_W();
+    vector<double>          gather_H();
+
+    ///////////////////////////////////////////////////////
+    // ALS / CCD++ Model functions
+    ///////////////////////////////////////////////////////
+    void                    update_als(int epoch_idx);
+    void                    update_ccd(int epoch_idx, int num_inner_iters);
+    double                  compute_train_rmse();
+
     ///////////////////////////////////////////////////////
     // Debugging functions
     ///////////////////////////////////////////////////////
@@ -68,9 +144,39 @@ private:
     // Private SGD update functions
     ///////////////////////////////////////////////////////
     double                  compute_learning_rate(int time);
-    void                    update_value_W_and_H(int item_index);
+    void                    update_value_W_and_H(int token);
     int                     get_priority_process_index();
     upcxx::future<>         transfer_item(int worker_id, int item_index);
+    upcxx::future<>         transfer_item_with_row(int worker_id, int item_index);
+
+    ///////////////////////////////////////////////////////
+    // Private hierarchical routing functions
+    ///////////////////////////////////////////////////////
+    int                     pop_item_from_queue();
+    void                    route_item(int item_index);
+    int                     get_local_priority_process_index();
+    int                     get_remote_priority_node_index();
+    long long int           get_node_load();
+    void                    refresh_remote_load();
+    void                    flush_remote_batches();
+    void                    update_token_work();
+
+    ///////////////////////////////////////////////////////
+    // Private ALS / CCD++ functions
+    ///////////////////////////////////////////////////////
+    void                    build_local_ratings();
+    void                    build_item_ratings();
+    void                    fetch_H_to_cache();
+    void                    fetch_W_to_cache();
+    void                    solve_least_squares(const vector<pair<int, double>> &ratings,
+                                                const vector<double> &factors, double *out);
+
+    ///////////////////////////////////////////////////////
+    // Private factor initialization functions
+    ///////////////////////////////////////////////////////
+    void                    get_item_shard(int &first_item, int &last_item);
+    void                    put_H_shard(const vector<double> &rows, int first_item, int last_item);
+    void                    orthonormalize_rows(vector<double> &Y, int num_cols);
 
     ///////////////////////////////////////////////////////
     // Linear algebra functions
@@ -81,6 +187,9 @@ private:
     vector<double>          vec_vec_add(vector<double> vec1, vector<double> vec2);
     vector<double>          vec_vec_subtract(vector<double> vec1, vector<double> vec2);
     double                  vec_norm_2(vector<double> vec);
+    void                    solve_spd_system(vector<double> &G, vector<double> &b, int n);
+    void                    cholesky_factorize(vector<double> &G, int n);
+    void                    symmetric_eigen(vector<double> S, int n, vector<double> &eigvals, vector<double> &V);
 
     ///////////////////////////////////////////////////////
     // Member
@@ -93,16 +202,88 @@ private:
     double                                          _beta_          { 0.0 };
     double                                          _lambda_        { 0.0 };
     unsigned                                        random_seed     { 0 };
+    uint64_t                                        init_seed       { 0 };      // same on every process
+    bool                                            als_ready       { false };
+    bool                                            ccd_ready       { false };
+    bool                                            reproducible    { false };  // lockstep ring schedule
+    bool                                            fifo_queues     { false };  // tokens served in arrival order
 
     std::default_random_engine                      random_engine;
     std::uniform_int_distribution<int>              randomer;
 
-    int*                                            update_step;
+    // Local rows of A and their update counts, flattened as [i * num_items + j]
+    // in mappings of the memory policy; A is moved in from the loader, whose
+    // late ratings may still land in it until finish_loading
+    MemoryPolicy                                    memory_policy;
+    string                                          memory_granted;
+    PolicyArray<int>                                update_step;
     upcxx::dist_object<vector<int>>                 user_index;
-    vector<vector<double>>                          A;
+    PolicyArray<double>                             A;
     upcxx::dist_object<upcxx::global_ptr<double>>   W;
     upcxx::dist_object<upcxx::global_ptr<double>>   H;          // default pointed by proc-0
-    upcxx::dist_object<queue<int>>                  item_queue;
+    upcxx::dist_object<TokenQueue>                  item_queue;
+
+    // Popularity-aware scheduling: a hot item j is split into item_split[j]
+    // sub-tokens; sub-token 0 is the token j itself, the others are numbered
+    // from num_items on. Sub-token s of item j serves the users with
+    // (user_idx % item_split[j] == s) and has its own row of H (row = token)
+    int                                             num_tokens      { -1 };
+    vector<int>                                     token_item;     // item of each token
+    vector<int>                                     token_slot;     // s of each token
+    vector<int>                                     item_split;     // number of sub-tokens of each item
+    vector<int>                                     first_subtoken; // token of sub-token 1 of each item, or -1
+    vector<int>                                     hot_items;      // items with more than one sub-token
+    vector<int>                                     hot_index;      // position in hot_items, or -1
+    double                                          idle_time       { 0.0 };  // in epochs with an empty queue
+    double                                          straggler_wait  { 0.0 };  // at the end of training
+
+    // Incremental training: W_i of a frozen local user is not written by SGD
+    vector<char>                                    frozen_user;    // empty when every user is trainable
+
+    // Sparse views of the ratings used by ALS and CCD++:
+    // local_ratings[i]  = (item, rating) pairs of the i-th local user
+    // owned_ratings[j'] = (user, rating) pairs of item j = j' * rank_n() + rank_me()
+    vector<vector<pair<int, double>>>               local_ratings;
+    vector<vector<pair<int, double>>>               owned_ratings;
+    upcxx::dist_object<vector<Rating>>              item_ratings;
+    vector<double>                                  W_cache;        // all rows of W, by global user index
+    vector<double>                                  H_cache;        // local copy of H (num_items x num_embeddings)
+    vector<vector<double>>                          residual;       // CCD++: A_ij - W_i * H_j on observed entries
+
+    // Hierarchical routing: ranks sharing memory form a "node"; each node keeps
+    // its own replica of H and the row H_j travels with token j between nodes
+    bool                                            hierarchical    { false };
+    upcxx::dist_object<upcxx::global_ptr<double>>   H_node;         // H of this node (H of proc-0 when flat)
+    upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> pending_work;   // TokenQueue::pending_work()
+    upcxx::dist_object<upcxx::global_ptr<std::atomic<long long int>>> node_load;      // pending work of the node
+    upcxx::team*                                    node_team       { nullptr };
+    shared_ptr<upcxx::team>                         emulated_team;  // set when NOMAD_RANKS_PER_NODE splits local_team
+    int                                             node_id         { -1 };
+    vector<vector<int>>                             node_members;   // world ranks of each node
+    vector<std::atomic<long long int>*>             node_pending_work;
+    int*                                            node_hops       { nullptr };    // hops of each token on this node
+    vector<long long int>                           remote_load;    // last known load of each node
+    vector<vector<int>>                             outbox_items;   // pending cross-node tokens, by node
+    vector<vector<double>>                          outbox_rows;    // H_j plus the error feedback of this node
+    vector<int>                                     next_member;    // round-robin receiver inside each node
+    long long int                                   num_routed      { 0 };
+    long long int                                   num_served      { 0 };      // tokens routed by this process
+    long long int                                   oldest_batched  { -1 };     // num_served when the oldest pending token was batched
+    int                                             batch_size      { 32 };
+    int                                             max_batch_age   { 64 };     // tokens served before a partial batch leaves
+    int                                             load_refresh    { 64 };
+    double                                          imbalance_ratio { 1.5 };
+
+    // Wire encoding of cross-node rows; the quantization error of each row
+    // is kept on the sending node and added back the next time it sends the row
+    WireCodec                                       wire_codec      { WireCodec::FP64 };
+    double*                                         node_error      { nullptr };
+    long long int                                   num_updates     { 0 };
+    long long int                                   bytes_sent      { 0 };
+
+    // Token-flow tracing (disabled until setup_tracing)
+    upcxx::dist_object<TokenTracer>                 tracer;
+    bool                                            tracing_idle    { false };
 
 };
 